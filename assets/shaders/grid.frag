@@ -0,0 +1,57 @@
+#version 150
+
+in vec3 model_pos;
+in vec3 camera_pos;
+
+uniform float grid_step;      // major line spacing at a camera height of 'grid_step'
+uniform float sub_divisions;  // minor lines per major cell, also the factor between levels
+uniform float fade_distance;
+
+uniform vec4 grid_color;
+uniform vec4 sub_div_color;
+uniform vec4 x_axis_color;
+uniform vec4 y_axis_color;
+
+out vec4 fragColor;
+
+// 1 on a line of the given spacing, 0 a pixel away from it
+float grid_line(vec2 coord, float step) {
+    vec2 cell = coord / step;
+    vec2 width = fwidth(cell);
+    vec2 dist = abs(fract(cell - 0.5) - 0.5) / width;
+    return 1.0 - min(min(dist.x, dist.y), 1.0);
+}
+
+float axis_line(float coord) {
+    return 1.0 - min(abs(coord) / fwidth(coord), 1.0);
+}
+
+void main() {
+    // pick the level from the camera height, the minor lines of a level fade out as the
+    // camera rises until they are the major lines of the next one
+    float height = max(abs(camera_pos.z), 1e-4);
+    float lod = log(height / grid_step) / log(sub_divisions);
+    float level = floor(lod);
+    float blend = lod - level;
+
+    float major_step = grid_step * pow(sub_divisions, level);
+    float minor_step = major_step / sub_divisions;
+
+    float minor = grid_line(model_pos.xy, minor_step) * (1.0 - blend);
+    float major = grid_line(model_pos.xy, major_step);
+
+    vec4 color = vec4(sub_div_color.rgb, sub_div_color.a * minor);
+    color = mix(color, grid_color, major);
+    color = mix(color, x_axis_color, axis_line(model_pos.y));
+    color = mix(color, y_axis_color, axis_line(model_pos.x));
+
+    // fade with distance, further away when looking from higher up
+    float fade_end = fade_distance + height * 10.0;
+    float dist = length(model_pos.xy - camera_pos.xy);
+    color.a *= 1.0 - smoothstep(fade_end * 0.3, fade_end, dist);
+
+    if (color.a <= 0.001)
+        discard;
+
+    fragColor = color;
+}
@@ -0,0 +1,23 @@
+#version 150
+
+in vec4 p3d_Vertex;
+
+uniform mat4 p3d_ModelViewProjectionMatrix;
+uniform mat4 p3d_ModelViewMatrixInverse;
+
+uniform float fade_distance;
+
+out vec3 model_pos;
+out vec3 camera_pos;
+
+void main() {
+    // the camera position in grid space is the translation of the inverse modelview
+    camera_pos = p3d_ModelViewMatrixInverse[3].xyz;
+
+    // a unit quad recentered under the camera and scaled to the fade radius, so the
+    // grid never ends within sight
+    float extent = fade_distance + abs(camera_pos.z) * 10.0;
+    model_pos = vec3(p3d_Vertex.xy * extent + camera_pos.xy, 0.0);
+
+    gl_Position = p3d_ModelViewProjectionMatrix * vec4(model_pos, 1.0);
+}
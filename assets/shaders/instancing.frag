@@ -0,0 +1,13 @@
+#version 150
+
+in vec2 texcoord;
+in vec4 color;
+
+uniform sampler2D p3d_Texture0;
+uniform vec4 p3d_ColorScale;
+
+out vec4 fragColor;
+
+void main() {
+    fragColor = texture(p3d_Texture0, texcoord) * color * p3d_ColorScale;
+}
@@ -0,0 +1,25 @@
+#version 150
+
+in vec4 p3d_Vertex;
+in vec4 p3d_Color;
+in vec2 p3d_MultiTexCoord0;
+
+uniform mat4 p3d_ModelViewProjectionMatrix;
+uniform samplerBuffer instance_data; // 4 texels per instance, 3 rows of a 3x4 transform then a color
+
+out vec2 texcoord;
+out vec4 color;
+
+void main() {
+    int base = gl_InstanceID * 4;
+    vec4 row0 = texelFetch(instance_data, base);
+    vec4 row1 = texelFetch(instance_data, base + 1);
+    vec4 row2 = texelFetch(instance_data, base + 2);
+
+    // rows are stored transposed so each one dots with the model space vertex
+    vec4 world = vec4(dot(row0, p3d_Vertex), dot(row1, p3d_Vertex), dot(row2, p3d_Vertex), 1.0);
+
+    gl_Position = p3d_ModelViewProjectionMatrix * world;
+    texcoord = p3d_MultiTexCoord0;
+    color = p3d_Color * texelFetch(instance_data, base + 3);
+}
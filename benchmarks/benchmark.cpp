@@ -0,0 +1,398 @@
+// Frame time benchmark, compiled into a copy of a demo (see PANDA_EDITOR_BENCHMARKS in the
+// top level CMakeLists.txt). It takes over 'Demon::start', drives the editor and the game
+// with scripted input for a fixed number of frames per scenario and writes frame time
+// percentiles, per stage timings and peak memory to a JSON file that can be compared
+// across commits.
+//
+// The output path is taken from PANDA_EDITOR_BENCHMARK_OUTPUT, defaulting to
+// 'benchmark_<demo>.json' in the working directory. A recording made with the editor's
+// record hotkey saved as 'benchmarks/recordings/<demo>.bin' is replayed as an extra scenario.
+// A window is still required, run under a virtual display (e.g. xvfb-run) on machines
+// without one.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include <asyncTaskManager.h>
+#include <clockObject.h>
+#include <graphicsWindowInputDevice.h>
+#include <keyboardButton.h>
+#include <load_prc_file.h>
+#include <mouseButton.h>
+#include <trueClock.h>
+#include <virtualFileSystem.h>
+
+#include "demon.hpp"
+
+#ifndef PANDA_EDITOR_BENCHMARK_DEMO
+#define PANDA_EDITOR_BENCHMARK_DEMO "unknown"
+#endif
+
+#ifndef PANDA_EDITOR_GIT_COMMIT
+#define PANDA_EDITOR_GIT_COMMIT "unknown"
+#endif
+
+static const int WARMUP_FRAMES = 30;  // per scenario, not measured
+
+// Scripted input goes through the window's input device, so it takes the same path as
+// real input: data graph, mouse watchers, button throwers, 'Mouse' and ImGui.
+class Input {
+public:
+    Input(GraphicsWindowInputDevice* device, const LVecBase2i& size) : device_(device), size_(size) {}
+
+    void down(const ButtonHandle& button) { if (device_) device_->button_down(button); }
+    void up(const ButtonHandle& button)   { if (device_) device_->button_up(button); }
+
+    void tap(const ButtonHandle& button) {
+        down(button);
+        up(button);
+    }
+
+    // 'x' and 'y' are fractions of the window size, from the top left
+    void move(float x, float y) {
+        if (device_)
+            device_->set_pointer_in_window(x * size_[0], y * size_[1]);
+    }
+
+private:
+    GraphicsWindowInputDevice* device_;
+    LVecBase2i                 size_;
+};
+
+struct Scenario {
+    std::string name;
+    bool        game_mode;
+    int         frames;
+    std::function<void(Input& input, int frame)> drive;  // called before every frame
+    std::string replay_path;                              // replays a recording instead
+};
+
+struct StageSamples {
+    std::vector<double> frame, engine_update, imgui, dispatch, render, tasks;
+};
+
+struct Result {
+    std::string  name;
+    StageSamples samples;
+    double       peak_memory_mb;
+};
+
+static double get_peak_memory_mb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+    return 0.0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // kilobytes
+#endif
+#endif
+}
+
+// nearest rank on a sorted copy, in milliseconds
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty())
+        return 0.0;
+
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::min(values.size(), std::max<size_t>(rank, 1)) - 1] * 1000.0;
+}
+
+static double mean(const std::vector<double>& values) {
+    if (values.empty())
+        return 0.0;
+
+    double sum = 0.0;
+    for (double value : values)
+        sum += value;
+    return sum / values.size() * 1000.0;
+}
+
+// ----------------------------------------------------------------------------------------- //
+// Scenarios, the editor ones run for every demo, the game ones depend on what the demo reacts to
+
+static void add_editor_scenarios(std::vector<Scenario>& scenarios) {
+    scenarios.push_back({ "editor_idle", false, 300, [](Input& input, int frame) {
+        if (frame == 0)
+            input.move(0.5f, 0.5f);
+    }, "" });
+
+    // alt + left drag, a full sweep left and right every 4 seconds at 60 fps
+    scenarios.push_back({ "editor_orbit", false, 600, [](Input& input, int frame) {
+        if (frame == 0) {
+            input.move(0.5f, 0.5f);
+            input.down(KeyboardButton::alt());
+            input.down(MouseButton::one());
+        }
+
+        const float t = frame / 240.0f * 2.0f * 3.14159265f;
+        input.move(0.5f + 0.3f * std::sin(t), 0.5f + 0.1f * std::sin(t * 2.0f));
+
+        if (frame == 599) {
+            input.up(MouseButton::one());
+            input.up(KeyboardButton::alt());
+        }
+    }, "" });
+
+    // alt + middle drag pans, alt + right drag dollies
+    scenarios.push_back({ "editor_pan_dolly", false, 400, [](Input& input, int frame) {
+        const ButtonHandle button = frame < 200 ? MouseButton::two() : MouseButton::three();
+        const int local = frame % 200;
+
+        if (local == 0) {
+            input.move(0.5f, 0.5f);
+            input.down(KeyboardButton::alt());
+            input.down(button);
+        }
+
+        input.move(0.5f + 0.2f * std::sin(local / 100.0f * 3.14159265f), 0.5f);
+
+        if (local == 199) {
+            input.up(button);
+            input.up(KeyboardButton::alt());
+        }
+    }, "" });
+
+    // repeated marquee selections across the viewport
+    scenarios.push_back({ "editor_marquee", false, 480, [](Input& input, int frame) {
+        const int local = frame % 60;
+        const float t = local / 59.0f;
+
+        if (local == 0) {
+            input.move(0.2f, 0.2f);
+            input.down(MouseButton::one());
+        }
+
+        input.move(0.2f + 0.6f * t, 0.2f + 0.5f * t);
+
+        if (local == 59)
+            input.up(MouseButton::one());
+    }, "" });
+}
+
+static void add_game_scenarios(std::vector<Scenario>& scenarios, const std::string& demo) {
+    if (demo == "roaming_ralph") {
+        // run forward the whole time, turning and orbiting the camera in between
+        scenarios.push_back({ "game_run", true, 900, [](Input& input, int frame) {
+            const ButtonHandle w = KeyboardButton::ascii_key('w');
+            const ButtonHandle a = KeyboardButton::ascii_key('a');
+            const ButtonHandle d = KeyboardButton::ascii_key('d');
+            const ButtonHandle e = KeyboardButton::ascii_key('e');
+
+            if (frame == 0)   { input.move(0.5f, 0.5f); input.down(w); }
+            if (frame == 120) input.down(a);
+            if (frame == 240) input.up(a);
+            if (frame == 360) input.down(d);
+            if (frame == 480) input.up(d);
+            if (frame == 600) input.down(e);
+            if (frame == 720) input.up(e);
+            if (frame == 899) input.up(w);
+        }, "" });
+    }
+    else if (demo == "thirdperson_character") {
+        // orbit with the pointer, pitch while the right button is held, zoom now and then
+        scenarios.push_back({ "game_orbit", true, 900, [](Input& input, int frame) {
+            const float t = frame / 300.0f * 2.0f * 3.14159265f;
+            input.move(0.5f + 0.3f * std::sin(t), 0.5f + 0.2f * std::sin(t * 3.0f));
+
+            if (frame == 300) input.down(MouseButton::three());
+            if (frame == 600) input.up(MouseButton::three());
+            if (frame % 90 == 45)
+                input.tap(frame % 180 == 45 ? MouseButton::wheel_up() : MouseButton::wheel_down());
+        }, "" });
+    }
+    else if (demo == "game_ui") {
+        // the demo's UI lives in the editor ImGui, hover and click across its windows
+        scenarios.push_back({ "editor_imgui", false, 600, [](Input& input, int frame) {
+            const float t = frame / 600.0f;
+            input.move(0.1f + 0.8f * t, 0.1f + 0.4f * std::abs(std::sin(t * 12.0f)));
+
+            if (frame % 30 == 0)  input.down(MouseButton::one());
+            if (frame % 30 == 2)  input.up(MouseButton::one());
+        }, "" });
+    }
+    else {
+        scenarios.push_back({ "game_idle", true, 300, nullptr, "" });
+    }
+
+    const std::string recording = "benchmarks/recordings/" + demo + ".bin";
+    if (VirtualFileSystem::get_global_ptr()->exists(Filename::from_os_specific(recording)))
+        scenarios.push_back({ "recorded", false, 0, nullptr, recording });
+}
+
+// ----------------------------------------------------------------------------------------- //
+static void step(Demon& demon, StageSamples* samples) {
+    TrueClock* clock = TrueClock::get_global_ptr();
+    const double start = clock->get_short_time();
+    AsyncTaskManager::get_global_ptr()->poll();
+    const double frame = clock->get_short_time() - start;
+
+    if (!samples)
+        return;
+
+    const Demon::FrameTimings& timings = demon.get_frame_timings();
+    const double stages = timings.engine_update + timings.imgui + timings.dispatch + timings.render;
+
+    samples->frame.push_back(frame);
+    samples->engine_update.push_back(timings.engine_update);
+    samples->imgui.push_back(timings.imgui);
+    samples->dispatch.push_back(timings.dispatch);
+    samples->render.push_back(timings.render);
+    samples->tasks.push_back(std::max(0.0, frame - stages));  // script updates and other tasks
+}
+
+static Result run_scenario(Demon& demon, const Scenario& scenario) {
+    Result result;
+    result.name = scenario.name;
+
+    GraphicsWindowInputDevice* device = nullptr;
+    if (demon.engine.win->get_num_input_devices() > 0)
+        device = DCAST(GraphicsWindowInputDevice, demon.engine.win->get_input_device(0));
+    Input input(device, demon.engine.get_size());
+
+    if (scenario.game_mode)
+        demon.enable_game_mode();
+
+    if (!scenario.replay_path.empty()) {
+        // replay at a fixed 60 Hz clock, the recording ends the scenario
+        bool done = false;
+        demon.engine.accept("input-replay-done", [&done]() { done = true; }, &done);
+
+        if (demon.engine.input_recorder.start_replay(scenario.replay_path, 1.0f / 60.0f)) {
+            for (int frame = 0; !done && !demon.engine.win->is_closed(); ++frame)
+                step(demon, frame < WARMUP_FRAMES ? nullptr : &result.samples);
+        }
+
+        demon.engine.ignore_all(&done);
+    }
+    else {
+        for (int frame = 0; frame < WARMUP_FRAMES + scenario.frames && !demon.engine.win->is_closed(); ++frame) {
+            const int scripted = frame - WARMUP_FRAMES;
+            if (scripted >= 0 && scenario.drive)
+                scenario.drive(input, scripted);
+
+            step(demon, scripted < 0 ? nullptr : &result.samples);
+        }
+    }
+
+    if (scenario.game_mode)
+        demon.exit_game_mode();
+
+    result.peak_memory_mb = get_peak_memory_mb();
+    return result;
+}
+
+static void write_stage(std::ostream& out, const char* name, const std::vector<double>& values, bool last) {
+    out << "        \"" << name << "\": { "
+        << "\"mean\": " << mean(values) << ", "
+        << "\"p50\": "  << percentile(values, 50.0) << ", "
+        << "\"p95\": "  << percentile(values, 95.0) << ", "
+        << "\"p99\": "  << percentile(values, 99.0) << ", "
+        << "\"max\": "  << percentile(values, 100.0) << " }" << (last ? "\n" : ",\n");
+}
+
+static bool write_json(const std::string& path, const std::string& demo, const LVecBase2i& size, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"demo\": \"" << demo << "\",\n";
+    out << "  \"commit\": \"" << PANDA_EDITOR_GIT_COMMIT << "\",\n";
+    out << "  \"window\": [" << size[0] << ", " << size[1] << "],\n";
+    out << "  \"unit\": \"ms\",\n";
+    out << "  \"peak_memory_mb\": " << get_peak_memory_mb() << ",\n";
+    out << "  \"scenarios\": [\n";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        const StageSamples& samples = result.samples;
+
+        out << "    {\n";
+        out << "      \"name\": \"" << result.name << "\",\n";
+        out << "      \"frames\": " << samples.frame.size() << ",\n";
+        out << "      \"peak_memory_mb\": " << result.peak_memory_mb << ",\n";
+        out << "      \"stages\": {\n";
+        write_stage(out, "frame",         samples.frame,         false);
+        write_stage(out, "engine_update", samples.engine_update, false);
+        write_stage(out, "imgui",         samples.imgui,         false);
+        write_stage(out, "dispatch",      samples.dispatch,      false);
+        write_stage(out, "render",        samples.render,        false);
+        write_stage(out, "tasks",         samples.tasks,         true);
+        out << "      }\n";
+        out << "    }" << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    out << "  ]\n";
+    out << "}\n";
+    return static_cast<bool>(out);
+}
+
+static void run_benchmark(Demon& demon) {
+    const std::string demo = PANDA_EDITOR_BENCHMARK_DEMO;
+
+    const char* output = std::getenv("PANDA_EDITOR_BENCHMARK_OUTPUT");
+    const std::string path = output && *output ? output : "benchmark_" + demo + ".json";
+
+    std::vector<Scenario> scenarios;
+    add_editor_scenarios(scenarios);
+    add_game_scenarios(scenarios, demo);
+
+    std::vector<Result> results;
+    for (const Scenario& scenario : scenarios) {
+        if (demon.engine.win->is_closed())
+            break;
+
+        std::cout << "Benchmark: " << demo << " / " << scenario.name << std::endl;
+        results.push_back(run_scenario(demon, scenario));
+
+        const StageSamples& samples = results.back().samples;
+        std::cout << "  p50 " << percentile(samples.frame, 50.0)
+                  << " ms, p95 " << percentile(samples.frame, 95.0)
+                  << " ms, p99 " << percentile(samples.frame, 99.0) << " ms" << std::endl;
+    }
+
+    if (write_json(path, demo, demon.engine.get_size(), results))
+        std::cout << "Benchmark: results written to " << path << std::endl;
+    else
+        std::cerr << "Benchmark: unable to write " << path << std::endl;
+}
+
+// Installed before 'main' runs, so the demo's own call to 'Demon::start' runs the benchmark.
+// The window is created by the demo's first use of 'Demon', after these settings are loaded.
+static bool install_benchmark() {
+    load_prc_file_data("benchmark",
+        "sync-video false\n"
+        "win-size 1280 720\n"
+        "win-origin 0 0\n"
+        "audio-library-name null\n");
+
+    Demon::set_start_hook(&run_benchmark);
+    return true;
+}
+
+static const bool benchmark_installed = install_benchmark();
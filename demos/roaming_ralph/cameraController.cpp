@@ -1,15 +1,19 @@
-#include <unordered_map>
 #include <nodePath.h>
 
+#include "inputMap.hpp"
+
 class CameraController {
 public:
     CameraController(NodePath& target_np, NodePath& cam) 
         : target_np(target_np),
-          camera(cam)
+          camera(cam),
+          orbit_axis(-1)
     {}
 
-    void init()
+    void init(const InputMap& input)
     {
+        orbit_axis = input.find_axis("orbit");
+
         // Create a floater object, which floats 2 units above Ralph
         floater = NodePath("CamLookAtTarget");
         floater.reparent_to(target_np);
@@ -22,13 +26,12 @@ public:
         camera.look_at(floater);
     }
 
-    void update(float dt, std::unordered_map<std::string, bool>& input_map) 
+    void update(float dt, const InputMap& input) 
     {
         // Handle camera movement left and right
-        if (input_map["cam-left"])
-            camera.set_x(camera, -20 * dt);
-        else if (input_map["cam-right"])
-            camera.set_x(camera, 20 * dt);
+        float orbit = orbit_axis >= 0 ? input.get_axis(orbit_axis) : 0.0f;
+        if (orbit != 0.0f)
+            camera.set_x(camera, 20 * orbit * dt);
 		
         // Compute camera movement constraints
         LVector3 cam_vec = target_np.get_pos() - camera.get_pos();
@@ -56,4 +59,5 @@ private:
     NodePath& target_np;
     NodePath& camera;
     NodePath  floater;
+    int       orbit_axis;
 };
@@ -1,39 +1,49 @@
-#include <unordered_map>
-
 #include <nodePath.h>
 #include <animControlCollection.h>
 
 #include "demon.hpp"
 #include "animUtils.hpp"
+#include "inputMap.hpp"
 
 class CharacterController {
 public:
     CharacterController(NodePath& character)
-	  : character(character), is_moving(false)
+	  : character(character), is_moving(false), turn_axis(-1), forward_action(-1)
 	{}
     
-	void init(const std::vector<NodePath>& anims)
+	void init(const std::vector<NodePath>& anims, const InputMap& input)
 	{
+		// resolved once, 'update' reads the input by index
+		turn_axis      = input.find_axis("turn");
+		forward_action = input.find_action("forward");
+		
 		// Bind the animation to the character
 		for (const NodePath& anim : anims) {
 			AnimUtils::bind_anims(character, anim, animator);
 		}
 	}
 	
-    void update(float dt, const std::unordered_map<std::string, bool>& key_map)
+    void update(float dt, const InputMap& input)
 	{
-		if (key_map.find("left") != key_map.end() && key_map.at("left"))
-			character.set_h(character.get_h() + 300 * dt);
+		const float turn    = turn_axis >= 0 ? input.get_axis(turn_axis) : 0.0f;
+		const bool  forward = forward_action >= 0 && input.is_held(forward_action);
+		
+		// accumulate the changes and write the transform once
+		LPoint3   pos = character.get_pos();
+		LVecBase3 hpr = character.get_hpr();
 		
-		if (key_map.find("right") != key_map.end() && key_map.at("right"))
-			character.set_h(character.get_h() - 300 * dt);
+		hpr[0] += 300 * turn * dt;
+		
+		if (forward)
+		{
+			LQuaternion quat;
+			quat.set_hpr(hpr);
+			pos += quat.xform(LVector3(0, -25 * dt, 0));
+		}
 		
-		if (key_map.find("forward") != key_map.end() && key_map.at("forward"))
-			character.set_y(character, -25 * dt);
+		character.set_pos_hpr(pos, hpr);
 
-		bool moving = key_map.find("forward") != key_map.end() && key_map.at("forward") ||
-		              key_map.find("left") != key_map.end() && key_map.at("left") ||
-		              key_map.find("right") != key_map.end() && key_map.at("right");
+		bool moving = forward || turn != 0.0f;
 
 		if (moving)
 		{
@@ -58,4 +68,6 @@ private:
     NodePath&             character;
     AnimControlCollection animator;
 	bool                  is_moving;
+	int                   turn_axis;
+	int                   forward_action;
 };
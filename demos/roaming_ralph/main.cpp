@@ -1,5 +1,4 @@
 #include <string>
-#include <unordered_map>
 
 #include <clockObject.h>
 #include <asyncTask.h>
@@ -11,8 +10,10 @@
 #include <collisionTraverser.h>
 #include <collisionHandlerQueue.h>
 #include <collideMask.h>
+#include <keyboardButton.h>
 
 #include "runtimeScript.hpp"
+#include "levelOptimizer.hpp"
 #include "characterController.cpp"
 #include "characterCollisionHandler.cpp"
 #include "cameraController.cpp"
@@ -42,37 +43,78 @@ public:
         // Take ralph to the starting position
         ralph.set_pos(start_pos);
 
+        // Declare the input actions before the controllers look them up
+        register_keys();
+
         // Initialize
-        character_controller.init(anims);
+        character_controller.init(anims, input);
         character_collision_handler.init(start_pos);
-        camera_controller.init();
+        camera_controller.init(input);
         camera_collision_handler.init();
-        
-        // Create a key map and register keys to their corresponding events
-        register_keys();
+
+        // Simulate at a fixed 60 Hz independent of the render frame rate
+        set_sim_rate(60.0f);
 
         // Finalize
         // Update at least once before the first 'RoamingRalphDemoUpdate' task update        
         c_trav.traverse(game.render);
-        character_controller.update(dt, input_map);
+        character_controller.update(dt, input);
         character_collision_handler.update();
-        camera_controller.update(dt, input_map);
+        camera_controller.update(dt, input);
+
+        ralph_state.reset(ralph);
+        camera_state.reset(camera);
     }
 
 protected:
-    void on_update(const PT(AsyncTask)&) {
+    void on_fixed_update(float fixed_dt) {
+        // step from the last simulated state, not from the interpolated one
+        ralph_state.restore(ralph);
+        camera_state.restore(camera);
+
         c_trav.traverse(game.render);
-        character_controller.update(dt, input_map);
+        character_controller.update(fixed_dt, input);
         character_collision_handler.update();
-        camera_controller.update(dt, input_map);
+        camera_controller.update(fixed_dt, input);
+
+        ralph_state.push(ralph);
+        camera_state.push(camera);
     }
-	
-	void on_event(const std::string& event_name)
-    {
-		RuntimeScript::on_event(event_name);
+
+    void on_render(float alpha) {
+        ralph_state.blend(ralph, alpha);
+        camera_state.blend(camera, alpha);
     }
 
 private:
+    // Last two simulated transforms of a node, rendered blended by the sim alpha
+    struct SimState {
+        LPoint3      prev_pos, curr_pos;
+        LQuaternion  prev_quat, curr_quat;
+
+        void reset(const NodePath& np) {
+            prev_pos  = curr_pos  = np.get_pos();
+            prev_quat = curr_quat = np.get_quat();
+        }
+
+        void push(const NodePath& np) {
+            prev_pos  = curr_pos;
+            prev_quat = curr_quat;
+            curr_pos  = np.get_pos();
+            curr_quat = np.get_quat();
+        }
+
+        void restore(NodePath& np) const {
+            np.set_pos_quat(curr_pos, curr_quat);
+        }
+
+        void blend(NodePath& np, float alpha) const {
+            // take the shorter arc
+            LQuaternion to = prev_quat.dot(curr_quat) < 0.0f ? -curr_quat : curr_quat;
+            np.set_pos_quat(lerp(prev_pos, curr_pos, alpha), slerp<LQuaternion, LQuaternion>(prev_quat, to, alpha));
+        }
+    };
+
 	// Character and camera controller related classes
     CharacterController       character_controller;
     CharacterCollisionHandler character_collision_handler;
@@ -86,9 +128,10 @@ private:
     // Global
     CollisionTraverser c_trav;
     
-    // Input handling
-    std::unordered_map<std::string, std::pair<std::string, bool>> buttons_map;
-    
+    // Interpolation
+    SimState ralph_state;
+    SimState camera_state;
+
     // References
 	NodePath camera;
 	
@@ -98,6 +141,9 @@ private:
         environment = resource_manager.load_model(environment_path);
         environment.reparent_to(game.render);
         environment.set_pos(LPoint3(0.0f, 0.0f, 0.0f));
+
+        // merge the level's static geometry, collision and 'Start_Pos' are kept as they are
+        LevelOptimizer().optimize(environment);
     }
 
     void load_actor()
@@ -115,20 +161,15 @@ private:
 
     void register_keys()
     {
-        buttons_map["a"] = {"left",      true};
-        buttons_map["d"] = {"right",     true};
-        buttons_map["w"] = {"forward",   true};
-        buttons_map["e"] = {"cam-left",  true};
-        buttons_map["q"] = {"cam-right", true};
-
-        buttons_map["a-up"] = {"left",      false};
-        buttons_map["d-up"] = {"right",     false};
-        buttons_map["w-up"] = {"forward",   false};
-        buttons_map["e-up"] = {"cam-left",  false};
-        buttons_map["q-up"] = {"cam-right", false};
-		
-		// register_button_map is defined in base RuntimeScript class
-		this->register_button_map(buttons_map);
+        // 'input' is sampled by the base RuntimeScript every frame
+        input.bind(input.add_action("left"),      KeyboardButton::ascii_key('a'));
+        input.bind(input.add_action("right"),     KeyboardButton::ascii_key('d'));
+        input.bind(input.add_action("forward"),   KeyboardButton::ascii_key('w'));
+        input.bind(input.add_action("cam-left"),  KeyboardButton::ascii_key('e'));
+        input.bind(input.add_action("cam-right"), KeyboardButton::ascii_key('q'));
+
+        input.add_axis("turn",  input.find_action("right"),    input.find_action("left"));
+        input.add_axis("orbit",  input.find_action("cam-left"), input.find_action("cam-right"));
     }
 };
 
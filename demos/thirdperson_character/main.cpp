@@ -1,5 +1,9 @@
 #include <cmath>
 #include <algorithm>
+
+#include <keyboardButton.h>
+#include <mouseButton.h>
+
 #include "runtimeScript.hpp"
 #include "cameraController.cpp"
 
@@ -18,24 +22,25 @@ public:
         this->accept("wheel_up", [this]() { camController.zoom(1); });
         this->accept("wheel_down", [this]() { camController.zoom(-1); });
 		
+		// held and released state is read from 'input' every frame
+		reset_action       = input.add_action("reset");
+		orbit_lock_action  = input.add_action("toggle-orbit-lock");
+		orbit_pitch_action = input.add_action("orbit-pitch");
+		
+		input.bind(reset_action,       KeyboardButton::ascii_key('r'));
+		input.bind(orbit_lock_action,  KeyboardButton::ascii_key('l'));
+		input.bind(orbit_pitch_action, MouseButton::three());
+		
         reset();
     }
 
 protected:
     void on_update(const PT(AsyncTask)&) {
+        if (input.was_released(reset_action)) reset();
+		if (input.was_released(orbit_lock_action)) camController.toggle_y_orbit_lock();
+		
         c_trav.traverse(game.render);		
-        camController.update(dt, mouse3_down);		
-    }
-    
-    void on_event(const std::string& event_name) {
-		// call base method as well
-        RuntimeScript::on_event(event_name);
-
-		// user defined keys
-        if (event_name == "r-up") reset();
-		if (event_name == "l-up") camController.toggle_y_orbit_lock();
-		if (event_name == "mouse3") mouse3_down = true;
-		if (event_name == "mouse3-up") mouse3_down = false;
+        camController.update(dt, input.is_held(orbit_pitch_action));		
     }
 
 private:
@@ -45,7 +50,9 @@ private:
 	
 	CollisionTraverser c_trav;
 	
-	bool mouse3_down = false;
+	int reset_action       = -1;
+	int orbit_lock_action  = -1;
+	int orbit_pitch_action = -1;
     
 
     void load_environment() {
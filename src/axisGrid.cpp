@@ -1,76 +1,182 @@
+#include <algorithm>
+#include <cmath>
+
 #include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexWriter.h>
+#include <graphicsStateGuardian.h>
+#include <omniBoundingVolume.h>
+#include <shader.h>
 #include "axisGrid.hpp"
 
 
 AxisGrid::AxisGrid(float grid_size, float grid_step, int sub_divisions)
     : NodePath("AxisGrid"),
+      fade_distance(250),
       grid_size(grid_size),
       grid_step(grid_step),
       sub_divisions(sub_divisions),
       show_end_cap_lines(true),
+      procedural(false),
       x_axis_color(1, 0, 0, 1),
       y_axis_color(0, 1, 0, 1),
       grid_color(0.4, 0.4, 0.4, 1),
       sub_div_color(0.35, 0.35, 0.35, 1),
       axis_thickness(1),
       grid_thickness(1),
-      sub_div_thickness(1) {}
+      sub_div_thickness(1),
+      last_lod(-1) {}
 
-void AxisGrid::create() {
-    // Set thickness
-    axis_lines.set_thickness(axis_thickness);
-    grid_lines.set_thickness(grid_thickness);
-    sub_division_lines.set_thickness(sub_div_thickness);
+void AxisGrid::create(GraphicsStateGuardian* gsg) {
+    procedural = _create_procedural(gsg);
+    if (!procedural)
+        _create_lines();
+}
+
+bool AxisGrid::_create_procedural(GraphicsStateGuardian* gsg) {
+    if (!gsg || !gsg->get_supports_glsl())
+        return false;
+
+    PT(Shader) shader = Shader::load(Shader::SL_GLSL, "assets/shaders/grid.vert", "assets/shaders/grid.frag");
+    if (!shader)
+        return false;
+
+    // unit quad, the vertex shader moves and scales it under the camera
+    PT(GeomVertexData) vdata = new GeomVertexData("grid", GeomVertexFormat::get_v3(), Geom::UH_static);
+    vdata->set_num_rows(4);
+    GeomVertexWriter vertex(vdata, "vertex");
+    vertex.add_data3(-1, -1, 0);
+    vertex.add_data3( 1, -1, 0);
+    vertex.add_data3( 1,  1, 0);
+    vertex.add_data3(-1,  1, 0);
+
+    PT(GeomTriangles) tris = new GeomTriangles(Geom::UH_static);
+    tris->add_vertices(0, 1, 2);
+    tris->add_vertices(0, 2, 3);
+
+    PT(Geom) geom = new Geom(vdata);
+    geom->add_primitive(tris);
+
+    PT(GeomNode) geom_node = new GeomNode("ProceduralGrid");
+    geom_node->add_geom(geom);
+
+    // the drawn area depends on the camera, never cull it
+    geom_node->set_bounds(new OmniBoundingVolume());
+    geom_node->set_final(true);
+
+    NodePath grid = attach_new_node(geom_node);
+    grid.set_shader(shader);
+    grid.set_shader_input("grid_step", grid_step);
+    grid.set_shader_input("sub_divisions", static_cast<float>(std::max(sub_divisions, 2)));
+    grid.set_shader_input("fade_distance", fade_distance);
+    grid.set_shader_input("grid_color", grid_color);
+    grid.set_shader_input("sub_div_color", sub_div_color);
+    grid.set_shader_input("x_axis_color", x_axis_color);
+    grid.set_shader_input("y_axis_color", y_axis_color);
+
+    grid.set_transparency(TransparencyAttrib::M_alpha);
+    grid.set_depth_write(false);
+    grid.set_two_sided(true);
 
-    // Set colors
-    grid_lines.set_color(grid_color);
-    sub_division_lines.set_color(sub_div_color);
+    return true;
+}
+
+void AxisGrid::_create_lines() {
+    axis_lines.set_thickness(axis_thickness);
 
-    // Generate grid lines
-    _draw_grid_lines(grid_step, grid_lines);
-    _draw_grid_lines(grid_step / sub_divisions, sub_division_lines);
+    // one mesh per level, each the base grid scaled by LEVEL_FACTOR, 'update' picks the
+    // ones around the camera distance so nothing is rebuilt while zooming
+    float scale = 1.0f / LEVEL_FACTOR;
+    for (int i = 0; i < NUM_LEVELS; ++i, scale *= LEVEL_FACTOR) {
+        LineSegs lines;
+        lines.set_thickness(grid_thickness);
+        _draw_grid_lines(grid_step * scale, grid_size * scale, lines);
 
-    // Draw axes
-    _draw_axis("x", axis_lines);
-    _draw_axis("y", axis_lines);
+        NodePath level = _attach_lines(lines);
+        level.set_transparency(TransparencyAttrib::M_alpha);
+        level.hide();
+        levels.push_back(level);
+    }
 
-    // Attach line nodes to grid
+    // axes span the largest level
+    const float axis_extent = grid_size * scale / LEVEL_FACTOR;
+    _draw_axis("x", axis_extent, axis_lines);
+    _draw_axis("y", axis_extent, axis_lines);
     _attach_lines(axis_lines);
-    _attach_lines(grid_lines);
-    _attach_lines(sub_division_lines);
+
+    last_lod = -1.0f;
+    update(grid_size);
+}
+
+void AxisGrid::update(float camera_distance) {
+    if (procedural || levels.empty())
+        return;
+
+    // level 1 is the base grid, it is the fine level while the camera is within 'grid_size'
+    float lod = std::log10(std::max(camera_distance, 1e-3f) / grid_size) + 1.0f;
+    lod = std::min(std::max(lod, 0.0f), static_cast<float>(NUM_LEVELS - 1));
+    if (std::fabs(lod - last_lod) < 0.01f)
+        return;
+    last_lod = lod;
+
+    // the fine level fades out while the next one turns from grid to sub division color and
+    // the one after fades in, at the next whole lod they have each moved one slot down
+    const int fine = static_cast<int>(std::floor(lod));
+    const float blend = lod - fine;
+
+    for (int i = 0; i < NUM_LEVELS; ++i) {
+        NodePath& level = levels[i];
+
+        if (i == fine) {
+            level.show();
+            level.set_color(sub_div_color[0], sub_div_color[1], sub_div_color[2], sub_div_color[3] * (1.0f - blend));
+        }
+        else if (i == fine + 1) {
+            level.show();
+            level.set_color(grid_color + (sub_div_color - grid_color) * blend);
+        }
+        else if (i == fine + 2) {
+            level.show();
+            level.set_color(grid_color[0], grid_color[1], grid_color[2], grid_color[3] * blend);
+        }
+        else {
+            level.hide();
+        }
+    }
 }
 
-void AxisGrid::_draw_grid_lines(float step, LineSegs& line_seg) {
-    for (float pos : _frange(0, grid_size, step)) {
+void AxisGrid::_draw_grid_lines(float step, float extent, LineSegs& line_seg) {
+    for (float pos : _frange(0, extent, step)) {
         // X-direction lines
-        line_seg.move_to(pos, -grid_size, 0);
-        line_seg.draw_to(pos, grid_size, 0);
-        line_seg.move_to(-pos, -grid_size, 0);
-        line_seg.draw_to(-pos, grid_size, 0);
+        line_seg.move_to(pos, -extent, 0);
+        line_seg.draw_to(pos, extent, 0);
+        line_seg.move_to(-pos, -extent, 0);
+        line_seg.draw_to(-pos, extent, 0);
 
         // Y-direction lines
-        line_seg.move_to(-grid_size, pos, 0);
-        line_seg.draw_to(grid_size, pos, 0);
-        line_seg.move_to(-grid_size, -pos, 0);
-        line_seg.draw_to(grid_size, -pos, 0);
+        line_seg.move_to(-extent, pos, 0);
+        line_seg.draw_to(extent, pos, 0);
+        line_seg.move_to(-extent, -pos, 0);
+        line_seg.draw_to(extent, -pos, 0);
     }
 }
 
-void AxisGrid::_draw_axis(const std::string& axis, LineSegs& line_seg) {
+void AxisGrid::_draw_axis(const std::string& axis, float extent, LineSegs& line_seg) {
     if (axis == "x") {
         line_seg.set_color(x_axis_color);
-        line_seg.move_to(-grid_size, 0, 0);
-        line_seg.draw_to(grid_size, 0, 0);
+        line_seg.move_to(-extent, 0, 0);
+        line_seg.draw_to(extent, 0, 0);
     } else if (axis == "y") {
         line_seg.set_color(y_axis_color);
-        line_seg.move_to(0, -grid_size, 0);
-        line_seg.draw_to(0, grid_size, 0);
+        line_seg.move_to(0, -extent, 0);
+        line_seg.draw_to(0, extent, 0);
     }
 }
 
-void AxisGrid::_attach_lines(LineSegs& line_seg) {
+NodePath AxisGrid::_attach_lines(LineSegs& line_seg) {
     NodePath node_path(line_seg.create());
     node_path.reparent_to(*this);
+    return node_path;
 }
 
 std::vector<float> AxisGrid::_frange(float start, float stop, float step) {
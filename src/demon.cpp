@@ -3,6 +3,7 @@
 #include <config_putil.h>
 #include <nodePath.h>
 #include <bitMask.h>
+#include <trueClock.h>
 
 #include "pathUtils.hpp"
 #include "taskUtils.hpp"
@@ -10,7 +11,9 @@
 #include "demon.hpp"
 #include "imgui.h"
 
-Demon::Demon() : game(*this), level_ed(*this) {
+Demon::StartHook Demon::start_hook_ = nullptr;
+
+Demon::Demon() : game(*this), level_ed(*this), _frame_timings() {
 	setup_paths();
 	
 	// Initializations
@@ -41,11 +44,23 @@ Demon::Demon() : game(*this), level_ed(*this) {
 		
 	// Create update task
 	PT(AsyncTask) update_task = (make_task([this](AsyncTask *task) -> AsyncTask::DoneStatus {
-
+		
+		TrueClock* clock = TrueClock::get_global_ptr();
+		double start = clock->get_short_time();
+		
 		engine.update();		
+		double updated = clock->get_short_time();
+		
 		imgui_update();
+		double imgui_done = clock->get_short_time();
+		
 		engine.dispatch_events(_mouse_over_ui);
+		double dispatched = clock->get_short_time();
+		
 		engine.engine->render_frame();
+		double rendered = clock->get_short_time();
+		
+		_frame_timings = { updated - start, imgui_done - updated, dispatched - imgui_done, rendered - dispatched };
 
 		_mouse_over_ui = false;
 		
@@ -99,6 +114,11 @@ Demon::~Demon() {
 }
 
 void Demon::start() {
+	if (start_hook_) {
+		start_hook_(*this);
+		return;
+	}
+	
 	while (!engine.win->is_closed()) {
 		AsyncTaskManager::get_global_ptr()->poll();	
 	}
@@ -123,12 +143,26 @@ void Demon::bind_events() {
 	engine.accept("control-3",   [this]() { engine.mouse.set_mouse_mode(WindowProperties::M_confined); });
 	engine.accept("control-r",   [this]() { engine.mouse.toggle_force_relative_mode(); });
 	
+	engine.accept("shift-f",   [this]() { toggle_game_mode_full_window();                 });
+	
 	engine.accept("shift-g",   [this]() {
 		if (!is_game_mode())
 			enable_game_mode();
 		else
 			exit_game_mode();
 	});
+	
+	// record a session and play it back, replay ignores live input until it ends
+	engine.accept("shift-r",   [this]() {
+		if (engine.input_recorder.is_recording())
+			engine.input_recorder.stop();
+		else if (!engine.input_recorder.is_replaying())
+			engine.input_recorder.start_recording(INPUT_RECORDING_PATH);
+	});
+	engine.accept("shift-p",   [this]() {
+		if (!engine.input_recorder.is_recording() && !engine.input_recorder.is_replaying())
+			engine.input_recorder.start_replay(INPUT_RECORDING_PATH);
+	});
 }
 
 void Demon::unbind_events() {}
@@ -138,18 +172,16 @@ void Demon::enable_game_mode() {
 	if (_is_game_mode)
 		return;
 	
-	/*
-	// Remove camera from display regions
-	engine.dr->set_camera(NodePath());
-	engine.dr2D->set_camera(NodePath());
-		
-	// Temporarily set display region as inactive
-	engine.dr->set_active(false);
-	engine.dr2D->set_active(false);
-	*/
+	_is_game_mode = true;
+	
+	// Stop culling, drawing and updating editor views, only the game display regions render
+	engine.set_editor_active(false);
+	p3d_imgui.set_input_enabled(false);
+	
+	if (settings.game_mode_full_window)
+		update_game_view();
 	
 	engine.trigger("game_mode_enabled");
-	_is_game_mode = true;
 	std::cout << "Game mode enabled\n";
 }
 
@@ -158,21 +190,25 @@ void Demon::exit_game_mode() {
 	if (!_is_game_mode)
 		return;
 	
-	/*
-	// Remove camera from display regions
-	engine.dr->set_camera(engine.scene_cam);
-	engine.dr2D->set_camera(engine.cam2D);
-		
-	// Set display regions back to active
-	engine.dr->set_active(true);
-	engine.dr2D->set_active(true);
-	*/
+	_is_game_mode = false;
+	
+	engine.set_editor_active(true);
+	p3d_imgui.set_input_enabled(true);
+	p3d_imgui.should_repaint = true;
+	
+	// back to the docked game view
+	update_game_view();
 	
 	engine.trigger("game_mode_disabled");
-	_is_game_mode = false;
 	std::cout << "Game mode disabled\n";
 }
 
+void Demon::toggle_game_mode_full_window() {
+	settings.game_mode_full_window = !settings.game_mode_full_window;
+	if (_is_game_mode)
+		update_game_view();
+}
+
 void Demon::increase_game_view_size() {
 	float increment = (1.0f - default_settings.game_view_size) / 4.0f;	
 	float min_size = default_settings.game_view_size;
@@ -202,6 +238,13 @@ void Demon::update_game_view(GameViewStyle style) {
 void Demon::update_game_view(GameViewStyle style, float width, float height) {
     float left, right, bottom, top;
 
+    // the game view covers the whole window while playing full window
+    if (_is_game_mode && settings.game_mode_full_window) {
+        style  = CENTER;
+        width  = 1.0f;
+        height = 1.0f;
+    }
+
     switch (style) {
         case CENTER:
             left   = 0.5f - width / 2;
@@ -271,6 +314,7 @@ void Demon::exit() {
 	
 	engine.clean_up();
 	p3d_imgui.clean_up();
+	game.p3d_imgui.clean_up();
 	engine.engine->remove_all_windows();
 
 	_cleaned_up = true;
@@ -285,26 +329,28 @@ void Demon::init_imgui(Panda3DImGui *panda3d_imgui, NodePath *parent, MouseWatch
     panda3d_imgui->setup_geom();
     panda3d_imgui->setup_shader(Filename("assets/shaders"));
     panda3d_imgui->setup_font();
-    panda3d_imgui->setup_event();
+    panda3d_imgui->setup_event(DCAST(ButtonThrower, engine.button_throwers[0].node()));
     panda3d_imgui->enable_file_drop();
+    panda3d_imgui->enable_docking();
 }
 
 void Demon::imgui_update() {
-	// Editor view ui update
-	ImGui::SetCurrentContext(this->p3d_imgui.context_);
-	
-	if (this->p3d_imgui.should_repaint) {
-		this->p3d_imgui.on_window_resized();
-		this->p3d_imgui.should_repaint = false;
-	}
-	
-	this->p3d_imgui.new_frame_imgui();
-	this->handle_imgui_mouse(this->engine.mouse_watcher, &this->p3d_imgui);
-	
-	engine.trigger("main_gui");
+	// Editor view ui update, its display region is off in game mode so the frame is skipped
+	if (!_is_game_mode) {
+		ImGui::SetCurrentContext(this->p3d_imgui.context_);
+		
+		if (this->p3d_imgui.should_repaint) {
+			this->p3d_imgui.on_window_resized();
+			this->p3d_imgui.should_repaint = false;
+		}
+		
+		this->p3d_imgui.new_frame_imgui();
+		
+		engine.trigger("main_gui");
 
-	this->p3d_imgui.render_imgui();
-	if(ImGui::GetIO().WantCaptureMouse) { _mouse_over_ui = true; }
+		this->p3d_imgui.render_imgui();
+		if(ImGui::GetIO().WantCaptureMouse) { _mouse_over_ui = true; }
+	}
 	
 	// Game view ui imgui
 	ImGui::SetCurrentContext(this->game.p3d_imgui.context_);
@@ -315,23 +361,8 @@ void Demon::imgui_update() {
 	}
 	
 	this->game.p3d_imgui.new_frame_imgui();
-	this->handle_imgui_mouse(this->game.mouse_watcher, &this->game.p3d_imgui);
 	engine.trigger("game_view_gui");
 
 	this->game.p3d_imgui.render_imgui();
 	if (ImGui::GetIO().WantCaptureMouse) { _mouse_over_ui = true; }
 }
-
-void Demon::handle_imgui_mouse(MouseWatcher* mw, Panda3DImGui* panda3d_imgui) {
-	
-	if(!mw->has_mouse())
-		return;
-	
-	for (const ButtonHandle& button: panda3d_imgui->btn_handles) {
-		
-		if(mw->is_button_down(button))
-			panda3d_imgui->on_button_down_or_up(button, true);
-		else
-			panda3d_imgui->on_button_down_or_up(button, false);
-	}
-}
@@ -1,7 +1,9 @@
+#include <algorithm>
+
 #include "engine.hpp"
 #include "constants.hpp"
 
-Engine::Engine() : mouse(*this), scene_cam(*this) {
+Engine::Engine() : mouse(*this), input_recorder(*this), scene_cam(*this), editor_active_(true) {
 
     data_root = NodePath("DataRoot");
 
@@ -50,6 +52,9 @@ void Engine::create_win() {
 		win_props,
 		GraphicsPipe::BF_require_window);
     win = DCAST(GraphicsWindow, output);
+
+    // open the window now so the gsg exists and its capabilities can be queried
+    engine->open_windows();
 }
 
 void Engine::create_3d_render() {
@@ -114,8 +119,8 @@ void Engine::create_2d_render() {
 void Engine::create_default_scene() {}
 
 void Engine::create_axis_grid() {
-    axis_grid = AxisGrid(100, 10, 2);
-    axis_grid.create();
+    axis_grid = AxisGrid(500, 10, 2);
+    axis_grid.create(win->get_gsg());
     axis_grid.set_light_off();
     axis_grid.reparent_to(render);
 }
@@ -134,7 +139,9 @@ void Engine::setup_mouse_keyboard(PT(MouseWatcher)& mw) {
     PT(ButtonThrower) button_thrower = new ButtonThrower("Button_Thrower");
 		
     NodePath mk_node = data_root.attach_new_node(mouse_and_keyboard);
-    NodePath mouse_watcher_np = mk_node.attach_new_node(mouse_watcher);
+    // recorded input is captured and replayed between the device and the watchers
+    NodePath recorder_np = mk_node.attach_new_node(input_recorder.get_node());
+    NodePath mouse_watcher_np = recorder_np.attach_new_node(mouse_watcher);
     NodePath button_thrower_np = mouse_watcher_np.attach_new_node(button_thrower);
 
     if (win->get_side_by_side_stereo()) {
@@ -201,19 +208,35 @@ void Engine::process_events(CPT_Event event) {
 }
 
 void Engine::update() {
+    // collect the pointer motion since the last frame before the traversal consumes it
+    mouse.capture();
+
     // traverse the data graph.This reads all the control
     // inputs(from the mouse and keyboard, for instance) and also
     // directly acts upon them(for instance, to move the avatar).
+    input_recorder.begin_frame();
     data_graph_trav.traverse(data_root.node());
+    input_recorder.end_frame();
 
     // process events
     while (!event_queue->is_queue_empty()) {
         process_events(event_queue->dequeue_event());
     }
 
-    // update mouse and camera
+    // update mouse and camera, the mouse is shared with the game so it always updates
     mouse.update();
-    scene_cam.update();
+    if (editor_active_) {
+        scene_cam.update();
+        axis_grid.update(scene_cam.get_target_distance());
+    }
+}
+
+void Engine::set_editor_active(bool active) {
+    editor_active_ = active;
+
+    // inactive display regions are neither culled nor drawn
+    dr->set_active(active);
+    dr2D->set_active(active);
 }
 
 void Engine::on_evt_size() {
@@ -270,18 +293,34 @@ void Engine::clean_up() {
     // engine->remove_all_windows();
 }
 
-void Engine::accept(const std::string& event_name, std::function<void()> callback) {
-	event_map[event_name].push_back(callback);
+void Engine::accept(const std::string& event_name, std::function<void()> callback, const void* owner) {
+	event_map[event_name].push_back({ std::move(callback), owner });
+}
+
+void Engine::accept(std::function<void(std::string event_name)> callback, const void* owner) {
+	unnamed_events.push_back({ std::move(callback), owner });
 }
 
-void Engine::accept(std::function<void(std::string event_name)> callback) {
-	unnamed_events.push_back(callback);
+void Engine::ignore_all(const void* owner) {
+	if (!owner)
+		return;
+	
+	auto is_owned = [owner](const EventCallback<std::function<void()>>& it) { return it.owner == owner; };
+	for (auto& it : event_map) {
+		auto& callbacks = it.second;
+		callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(), is_owned), callbacks.end());
+	}
+	
+	unnamed_events.erase(
+		std::remove_if(unnamed_events.begin(), unnamed_events.end(),
+			[owner](const EventCallback<std::function<void(std::string)>>& it) { return it.owner == owner; }),
+		unnamed_events.end());
 }
 
 void Engine::trigger(const std::string& event_name) {
 	if (event_map.find(event_name) != event_map.end()) {
-		for (auto& callback : event_map[event_name]) {
-			callback();
+		for (auto& it : event_map[event_name]) {
+			it.callback();
 		}
 	}
 }
@@ -297,8 +336,8 @@ void Engine::dispatch_events(bool ignore_mouse) {
 		event = it->first.p();
 
 		// send raw event hooks
-		for (const auto& callback : unnamed_events) {
-			callback(event->get_name());  // Call the callback with the argument
+		for (const auto& it : unnamed_events) {
+			it.callback(event->get_name());  // Call the callback with the argument
 		}
 
 		// other
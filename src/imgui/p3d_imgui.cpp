@@ -23,7 +23,9 @@
 */
 
 
+#include <cmath>
 #include <cstring>
+#include <limits>
 
 #include <throw_event.h>
 #include <geomNode.h>
@@ -31,10 +33,16 @@
 #include <graphicsWindow.h>
 #include <mouseWatcher.h>
 #include <mouseButton.h>
+#include <keyboardButton.h>
+#include <buttonRegistry.h>
+#include <buttonThrower.h>
+#include <eventHandler.h>
 #include <colorAttrib.h>
 #include <colorBlendAttrib.h>
 #include <depthTestAttrib.h>
 #include <cullFaceAttrib.h>
+#include <cullBinAttrib.h>
+#include <omniBoundingVolume.h>
 #include <scissorAttrib.h>
 #include <nodePath.h>
 #include <nodePathCollection.h>
@@ -49,6 +57,70 @@
 #include <shellapi.h>
 #endif
 
+static ImGuiKey to_imgui_key(const ButtonHandle& button)
+{
+    if (button == KeyboardButton::tab())          return ImGuiKey_Tab;
+    if (button == KeyboardButton::left())         return ImGuiKey_LeftArrow;
+    if (button == KeyboardButton::right())        return ImGuiKey_RightArrow;
+    if (button == KeyboardButton::up())           return ImGuiKey_UpArrow;
+    if (button == KeyboardButton::down())         return ImGuiKey_DownArrow;
+    if (button == KeyboardButton::page_up())      return ImGuiKey_PageUp;
+    if (button == KeyboardButton::page_down())    return ImGuiKey_PageDown;
+    if (button == KeyboardButton::home())         return ImGuiKey_Home;
+    if (button == KeyboardButton::end())          return ImGuiKey_End;
+    if (button == KeyboardButton::insert())       return ImGuiKey_Insert;
+    if (button == KeyboardButton::del())          return ImGuiKey_Delete;
+    if (button == KeyboardButton::backspace())    return ImGuiKey_Backspace;
+    if (button == KeyboardButton::space())        return ImGuiKey_Space;
+    if (button == KeyboardButton::enter())        return ImGuiKey_Enter;
+    if (button == KeyboardButton::escape())       return ImGuiKey_Escape;
+    if (button == KeyboardButton::lcontrol())     return ImGuiKey_LeftCtrl;
+    if (button == KeyboardButton::rcontrol())     return ImGuiKey_RightCtrl;
+    if (button == KeyboardButton::lshift())       return ImGuiKey_LeftShift;
+    if (button == KeyboardButton::rshift())       return ImGuiKey_RightShift;
+    if (button == KeyboardButton::lalt())         return ImGuiKey_LeftAlt;
+    if (button == KeyboardButton::ralt())         return ImGuiKey_RightAlt;
+    if (button == KeyboardButton::lmeta())        return ImGuiKey_LeftSuper;
+    if (button == KeyboardButton::rmeta())        return ImGuiKey_RightSuper;
+    if (button == KeyboardButton::caps_lock())    return ImGuiKey_CapsLock;
+    if (button == KeyboardButton::scroll_lock())  return ImGuiKey_ScrollLock;
+    if (button == KeyboardButton::num_lock())     return ImGuiKey_NumLock;
+    if (button == KeyboardButton::print_screen()) return ImGuiKey_PrintScreen;
+    if (button == KeyboardButton::pause())        return ImGuiKey_Pause;
+    if (button == KeyboardButton::menu())         return ImGuiKey_Menu;
+
+    for (int i = 1; i <= 12; ++i)
+    {
+        if (button == KeyboardButton::f(i))
+            return static_cast<ImGuiKey>(ImGuiKey_F1 + (i - 1));
+    }
+
+    if (!button.has_ascii_equivalent())
+        return ImGuiKey_None;
+
+    const char c = button.get_ascii_equivalent();
+    if (c >= 'a' && c <= 'z') return static_cast<ImGuiKey>(ImGuiKey_A + (c - 'a'));
+    if (c >= '0' && c <= '9') return static_cast<ImGuiKey>(ImGuiKey_0 + (c - '0'));
+
+    switch (c)
+    {
+    case '\'': return ImGuiKey_Apostrophe;
+    case ',':  return ImGuiKey_Comma;
+    case '-':  return ImGuiKey_Minus;
+    case '.':  return ImGuiKey_Period;
+    case '/':  return ImGuiKey_Slash;
+    case ';':  return ImGuiKey_Semicolon;
+    case '=':  return ImGuiKey_Equal;
+    case '[':  return ImGuiKey_LeftBracket;
+    case '\\': return ImGuiKey_Backslash;
+    case ']':  return ImGuiKey_RightBracket;
+    case '`':  return ImGuiKey_GraveAccent;
+    default:   return ImGuiKey_None;
+    }
+}
+
+// ************************************************************************************************
+
 class Panda3DImGui::WindowProc : public GraphicsWindowProc
 {
 public:
@@ -108,38 +180,32 @@ Panda3DImGui::Panda3DImGui() {}
 
 Panda3DImGui::~Panda3DImGui() {}
 
+Panda3DImGui::SharedResources& Panda3DImGui::get_shared_resources()
+{
+    static SharedResources shared;
+    return shared;
+}
+
 void Panda3DImGui::init(GraphicsWindow* window, MouseWatcher* mw, NodePath *parent)
 {
 	this->window_ = window;
 	this->mouse_watcher = mw;
 	root_ = parent->attach_new_node("ImGUIRoot", 1000);
 	
-	// 2. Set mouse and modifier buttons
-	// mouse buttons
-	btn_handles.push_back(MouseButton::one());
-	btn_handles.push_back(MouseButton::two());   
-	btn_handles.push_back(MouseButton::three());
-	btn_handles.push_back(MouseButton::four()); 
-	btn_handles.push_back(MouseButton::five());     
-	btn_handles.push_back(MouseButton::wheel_up());
-	btn_handles.push_back(MouseButton::wheel_down()); 
-	btn_handles.push_back(MouseButton::wheel_left());
-	btn_handles.push_back(MouseButton::wheel_right()); 
-	
-	// keyboard buttons
-	btn_handles.push_back(KeyboardButton::control());
-	btn_handles.push_back(KeyboardButton::shift());
-	btn_handles.push_back(KeyboardButton::alt());
-	btn_handles.push_back(KeyboardButton::meta());
+	// 2. Init ImGUI, all contexts share a single font atlas
+	SharedResources& shared = get_shared_resources();
+	if (!shared.font_atlas)
+		shared.font_atlas = IM_NEW(ImFontAtlas)();
 	
-	// 3. Init ImGUI
-	context_ = ImGui::CreateContext();
+	context_ = ImGui::CreateContext(shared.font_atlas);
 	ImGui::SetCurrentContext(context_);
+	shared.num_contexts++;
 	
     ImGuiIO& io = ImGui::GetIO();
 
     // setup back-end capabilities flags
     io.BackendFlags |= ImGuiBackendFlags_HasSetMousePos;
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
 	
 	// 
 	last_resolution_x = 800;
@@ -166,30 +232,53 @@ void Panda3DImGui::setup_style(Style style)
 
 void Panda3DImGui::setup_geom()
 {
-    PT(GeomVertexArrayFormat) array_format = new GeomVertexArrayFormat(
-        InternalName::get_vertex(), 4, Geom::NT_stdfloat, Geom::C_point,
-        InternalName::get_color(), 1, Geom::NT_packed_dabc, Geom::C_color
-    );
+    SharedResources& shared = get_shared_resources();
+    if (!shared.vformat)
+    {
+        PT(GeomVertexArrayFormat) array_format = new GeomVertexArrayFormat(
+            InternalName::get_vertex(), 4, Geom::NT_stdfloat, Geom::C_point,
+            InternalName::get_color(), 1, Geom::NT_packed_dabc, Geom::C_color
+        );
+
+        shared.vformat = GeomVertexFormat::register_format(new GeomVertexFormat(array_format));
+    }
+
+    vformat_ = shared.vformat;
 
-    vformat_ = GeomVertexFormat::register_format(new GeomVertexFormat(array_format));
+    // all draw lists of a frame are packed into this vertex data and drawn by the
+    // Geoms of a single GeomNode, ImGui clips its own geometry so culling is skipped.
+    vdata_ = new GeomVertexData("imgui-vertex", vformat_, GeomEnums::UsageHint::UH_stream);
+
+    geom_node_ = new GeomNode("imgui-geom");
+    geom_node_->set_bounds(new OmniBoundingVolume());
+    geom_node_->set_final(true);
+    root_.attach_new_node(geom_node_);
 
     root_.set_state(RenderState::make(
         ColorAttrib::make_vertex(),
         ColorBlendAttrib::make(ColorBlendAttrib::M_add, ColorBlendAttrib::O_incoming_alpha, ColorBlendAttrib::O_one_minus_incoming_alpha),
         DepthTestAttrib::make(DepthTestAttrib::M_none),
-        CullFaceAttrib::make(CullFaceAttrib::M_cull_none)
+        CullFaceAttrib::make(CullFaceAttrib::M_cull_none),
+        CullBinAttrib::make("unsorted", 0) // keep ImGui's submission order
     ));
 }
 
 void Panda3DImGui::setup_shader(const Filename& shader_dir_path)
 {
-    root_.set_shader(Shader::load(
-        Shader::SL_GLSL,
-        shader_dir_path / "panda3d_imgui.vert.glsl",
-        shader_dir_path / "panda3d_imgui.frag.glsl",
-        "",
-        "",
-        ""));
+    SharedResources& shared = get_shared_resources();
+    PT(Shader)& shader = shared.shaders[shader_dir_path.get_fullpath()];
+    if (!shader)
+    {
+        shader = Shader::load(
+            Shader::SL_GLSL,
+            shader_dir_path / "panda3d_imgui.vert.glsl",
+            shader_dir_path / "panda3d_imgui.frag.glsl",
+            "",
+            "",
+            "");
+    }
+
+    root_.set_shader(shader);
 }
 
 void Panda3DImGui::setup_shader(Shader* shader)
@@ -199,46 +288,38 @@ void Panda3DImGui::setup_shader(Shader* shader)
 
 void Panda3DImGui::setup_font()
 {
+    // the atlas is shared, only the first context adds the default font
     ImGuiIO& io = ImGui::GetIO();
-    io.Fonts->AddFontDefault();
+    if (io.Fonts->Fonts.empty())
+        io.Fonts->AddFontDefault();
     setup_font_texture();
 }
 
 void Panda3DImGui::setup_font(const char* font_filename, float font_size)
 {
+    // the atlas is shared, a font already added by another context is not added again
     ImGuiIO& io = ImGui::GetIO();
-    io.Fonts->AddFontFromFileTTF(font_filename, font_size);
+    SharedResources& shared = get_shared_resources();
+    if (shared.fonts.insert(std::string(font_filename) + "@" + std::to_string(font_size)).second)
+        io.Fonts->AddFontFromFileTTF(font_filename, font_size);
     setup_font_texture();
 }
 
-void Panda3DImGui::setup_event()
+void Panda3DImGui::setup_event(ButtonThrower* button_thrower)
 {
-    ImGuiIO& io = ImGui::GetIO();
-
     // for button holder although the variable is not used.
     button_map_ = window_->get_keyboard_map();
 
-    io.KeyMap[ImGuiKey_Tab]        = KeyboardButton::tab().get_index();
-    io.KeyMap[ImGuiKey_LeftArrow]  = KeyboardButton::left().get_index();
-    io.KeyMap[ImGuiKey_RightArrow] = KeyboardButton::right().get_index();
-    io.KeyMap[ImGuiKey_UpArrow]    = KeyboardButton::up().get_index();
-    io.KeyMap[ImGuiKey_DownArrow]  = KeyboardButton::down().get_index();
-    io.KeyMap[ImGuiKey_PageUp]     = KeyboardButton::page_up().get_index();
-    io.KeyMap[ImGuiKey_PageDown]   = KeyboardButton::page_down().get_index();
-    io.KeyMap[ImGuiKey_Home]       = KeyboardButton::home().get_index();
-    io.KeyMap[ImGuiKey_End]        = KeyboardButton::end().get_index();
-    io.KeyMap[ImGuiKey_Insert]     = KeyboardButton::insert().get_index();
-    io.KeyMap[ImGuiKey_Delete]     = KeyboardButton::del().get_index();
-    io.KeyMap[ImGuiKey_Backspace]  = KeyboardButton::backspace().get_index();
-    io.KeyMap[ImGuiKey_Space]      = KeyboardButton::space().get_index();
-    io.KeyMap[ImGuiKey_Enter]      = KeyboardButton::enter().get_index();
-    io.KeyMap[ImGuiKey_Escape]     = KeyboardButton::escape().get_index();
-    io.KeyMap[ImGuiKey_A]          = KeyboardButton::ascii_key('a').get_index();
-    io.KeyMap[ImGuiKey_C]          = KeyboardButton::ascii_key('c').get_index();
-    io.KeyMap[ImGuiKey_V]          = KeyboardButton::ascii_key('v').get_index();
-    io.KeyMap[ImGuiKey_X]          = KeyboardButton::ascii_key('x').get_index();
-    io.KeyMap[ImGuiKey_Y]          = KeyboardButton::ascii_key('y').get_index();
-    io.KeyMap[ImGuiKey_Z]          = KeyboardButton::ascii_key('z').get_index();
+    // Input is pushed to ImGui once per transition instead of polling every button each
+    // frame, all contexts share the thrower and filter the events in their hooks.
+    button_thrower->set_button_down_event(BUTTON_DOWN_EVENT_NAME);
+    button_thrower->set_button_up_event(BUTTON_UP_EVENT_NAME);
+    button_thrower->set_keystroke_event(KEYSTROKE_EVENT_NAME);
+
+    EventHandler* event_handler = EventHandler::get_global_event_handler();
+    event_handler->add_hook(BUTTON_DOWN_EVENT_NAME, &Panda3DImGui::on_button_event, this);
+    event_handler->add_hook(BUTTON_UP_EVENT_NAME, &Panda3DImGui::on_button_event, this);
+    event_handler->add_hook(KEYSTROKE_EVENT_NAME, &Panda3DImGui::on_keystroke_event, this);
 }
 
 void Panda3DImGui::enable_file_drop()
@@ -255,6 +336,18 @@ void Panda3DImGui::enable_file_drop()
 #endif
 }
 
+bool Panda3DImGui::enable_docking()
+{
+    // docking is only available when built against the ImGui docking branch
+#ifdef IMGUI_HAS_DOCK
+    ImGuiIO& io = ImGui::GetIO();
+    io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+    return true;
+#else
+    return false;
+#endif
+}
+
 void Panda3DImGui::on_window_resized()
 {
     if (window_.is_valid_pointer())
@@ -280,13 +373,10 @@ void Panda3DImGui::on_window_resized(const LVecBase2& size)
 
 	// ------------------------------------------------------------------------------
     // Optional: Update font scaling uniformly or independently
+    // The font atlas is shared by all contexts and does not depend on the resolution,
+    // so it is scaled per context instead of being rebuilt.
     float font_scale_factor = (scale_factor_x + scale_factor_y) / 2.0f; // Average
     ImGui::GetIO().FontGlobalScale = font_scale_factor;
-
-    // Rebuild font atlas
-    ImFontAtlas* font_atlas = io.Fonts;
-    font_atlas->Clear();
-    setup_font();
 	// ------------------------------------------------------------------------------
 
     // Save the new resolution as the last resolution for future reference
@@ -317,67 +407,119 @@ void Panda3DImGui::on_window_resized(const LVecBase2& size)
 
 void Panda3DImGui::on_button_down_or_up(const ButtonHandle& button, bool down)
 {
-    if (button == ButtonHandle::none())
+    if (button == ButtonHandle::none() || !context_)
         return;
 	
-    ImGuiIO& io = ImGui::GetIO();
+    // hooks run outside of this context's frame, so don't rely on the current context
+    ImGuiIO& io = context_->IO;
 		
     if (MouseButton::is_mouse_button(button))
     {
         if (button == MouseButton::one())
         {
-			io.MouseDown[0] = down;
+			io.AddMouseButtonEvent(0, down);
         }
         else if (button == MouseButton::three())
         {
-            io.MouseDown[1] = down;
+            io.AddMouseButtonEvent(1, down);
         }
         else if (button == MouseButton::two())
         {
-            io.MouseDown[2] = down;
+            io.AddMouseButtonEvent(2, down);
         }
         else if (button == MouseButton::four())
         {
-            io.MouseDown[3] = down;
+            io.AddMouseButtonEvent(3, down);
         }
         else if (button == MouseButton::five())
         {
-            io.MouseDown[4] = down;
+            io.AddMouseButtonEvent(4, down);
         }
         else if (down)
         {
+            // a wheel notch is thrown as a single down / up pair
             if (button == MouseButton::wheel_up())
-                io.MouseWheel += 1;
+                io.AddMouseWheelEvent(0.0f, 1.0f);
             else if (button == MouseButton::wheel_down())
-                io.MouseWheel -= 1;
+                io.AddMouseWheelEvent(0.0f, -1.0f);
             else if (button == MouseButton::wheel_right())
-                io.MouseWheelH += 1;
+                io.AddMouseWheelEvent(1.0f, 0.0f);
             else if (button == MouseButton::wheel_left())
-                io.MouseWheelH -= 1;
+                io.AddMouseWheelEvent(-1.0f, 0.0f);
         }
     }
     else
     {
-        io.KeysDown[button.get_index()] = down;
-
         if (button == KeyboardButton::control())
-            io.KeyCtrl = down;
+            io.AddKeyEvent(ImGuiMod_Ctrl, down);
         else if (button == KeyboardButton::shift())
-            io.KeyShift = down;
+            io.AddKeyEvent(ImGuiMod_Shift, down);
         else if (button == KeyboardButton::alt())
-            io.KeyAlt = down;
+            io.AddKeyEvent(ImGuiMod_Alt, down);
         else if (button == KeyboardButton::meta())
-            io.KeySuper = down;
+            io.AddKeyEvent(ImGuiMod_Super, down);
+
+        ImGuiKey key = to_imgui_key(button);
+        if (key != ImGuiKey_None)
+            io.AddKeyEvent(key, down);
     }
 }
 
 void Panda3DImGui::on_keystroke(wchar_t keycode)
 {
-    if (keycode < 0 || keycode >= (std::numeric_limits<ImWchar>::max)())
+    if (keycode < 0 || keycode >= (std::numeric_limits<ImWchar>::max)() || !context_)
         return;
 
-    ImGuiIO& io = ImGui::GetIO();
-    io.AddInputCharacter(keycode);
+    context_->IO.AddInputCharacter(keycode);
+}
+
+void Panda3DImGui::set_input_enabled(bool enabled)
+{
+    if (enabled == input_enabled_)
+        return;
+
+    input_enabled_ = enabled;
+
+    // losing focus releases every held key and button on the next frame, so nothing
+    // pressed while the input was off stays stuck
+    if (context_)
+        context_->IO.AddFocusEvent(enabled);
+}
+
+void Panda3DImGui::on_button_event(const Event* event, void* data)
+{
+    Panda3DImGui* self = static_cast<Panda3DImGui*>(data);
+    if (event->get_num_parameters() == 0 || !self->mouse_watcher || !self->input_enabled_)
+        return;
+
+    const bool down = event->get_name() == BUTTON_DOWN_EVENT_NAME;
+
+    // presses go to the context under the mouse, releases always go through so
+    // no context is left with a stuck button.
+    if (down && !self->mouse_watcher->has_mouse())
+        return;
+
+    // the button name is the last parameter, the time may precede it
+    const EventParameter& param = event->get_parameter(event->get_num_parameters() - 1);
+    if (!param.is_string())
+        return;
+
+    self->on_button_down_or_up(ButtonRegistry::ptr()->find_button(param.get_string_value()), down);
+}
+
+void Panda3DImGui::on_keystroke_event(const Event* event, void* data)
+{
+    Panda3DImGui* self = static_cast<Panda3DImGui*>(data);
+    if (event->get_num_parameters() == 0 || !self->mouse_watcher || !self->input_enabled_ ||
+        !self->mouse_watcher->has_mouse())
+        return;
+
+    const EventParameter& param = event->get_parameter(event->get_num_parameters() - 1);
+    if (!param.is_wstring())
+        return;
+
+    for (wchar_t keycode : param.get_wstring_value())
+        self->on_keystroke(keycode);
 }
 
 bool Panda3DImGui::new_frame_imgui()
@@ -409,14 +551,14 @@ bool Panda3DImGui::new_frame_imgui()
             }
             else
             {
-                io.MousePos.x = convert_to_range(mouse_watcher->get_mouse_x(), -1.0f, 1.0f, 0.0f, static_cast<float>(window_->get_x_size()));
-                io.MousePos.y = convert_to_range(mouse_watcher->get_mouse_y(), 1.0f, -1.0f, 0.0f, static_cast<float>(window_->get_y_size()));
+                io.AddMousePosEvent(
+                    convert_to_range(mouse_watcher->get_mouse_x(), -1.0f, 1.0f, 0.0f, static_cast<float>(window_->get_x_size())),
+                    convert_to_range(mouse_watcher->get_mouse_y(), 1.0f, -1.0f, 0.0f, static_cast<float>(window_->get_y_size())));
             }
         }
         else
         {
-            io.MousePos.x = -FLT_MAX;
-            io.MousePos.y = -FLT_MAX;
+            io.AddMousePosEvent(-FLT_MAX, -FLT_MAX);
         }
     }
 
@@ -441,86 +583,120 @@ bool Panda3DImGui::render_imgui()
     auto draw_data = ImGui::GetDrawData();
     //draw_data->ScaleClipRects(io.DisplayFramebufferScale);
 
-    auto npc = root_.get_children();
-    for (int k = 0, k_end = npc.get_num_paths(); k < k_end; ++k)
-        npc.get_path(k).detach_node();
+    geom_node_->remove_all_geoms();
+    num_geoms_ = 0;
 
-    for (int k = 0; k < draw_data->CmdListsCount; ++k)
+    if (draw_data->TotalVtxCount <= 0)
+        return true;
+
+    // 1. Pack the vertices of all draw lists into the single vertex buffer of this frame
     {
-        const ImDrawList* cmd_list = draw_data->CmdLists[k];
+        auto vertex_handle = vdata_->modify_array_handle(0);
+        if (vertex_handle->get_num_rows() < draw_data->TotalVtxCount)
+            vertex_handle->unclean_set_num_rows(draw_data->TotalVtxCount);
 
-        if (!(k < static_cast<int>(geom_data_.size())))
+        unsigned char* vertex_ptr = vertex_handle->get_write_pointer();
+        for (int k = 0; k < draw_data->CmdListsCount; ++k)
         {
-            geom_data_.push_back({
-                new GeomVertexData("imgui-vertex-" + std::to_string(k), vformat_, GeomEnums::UsageHint::UH_stream),
-                {}
-            });
-        }
+            const ImDrawList* cmd_list = draw_data->CmdLists[k];
+            const size_t size = cmd_list->VtxBuffer.Size * sizeof(decltype(cmd_list->VtxBuffer)::value_type);
 
-        auto& geom_list = geom_data_[k];
+            std::memcpy(vertex_ptr, reinterpret_cast<const unsigned char*>(cmd_list->VtxBuffer.Data), size);
+            vertex_ptr += size;
+        }
+    }
 
-        auto vertex_handle = geom_list.vdata->modify_array_handle(0);
-        if (vertex_handle->get_num_rows() < cmd_list->VtxBuffer.Size)
-            vertex_handle->unclean_set_num_rows(cmd_list->VtxBuffer.Size);
+    // 2. Rebase the indices of each draw command onto the packed buffer, consecutive
+    // commands with the same state are merged into a single Geom.
+    CPT(RenderState) batch_state;
+    index_buffer_.clear();
 
-        std::memcpy(
-            vertex_handle->get_write_pointer(),
-            reinterpret_cast<const unsigned char*>(cmd_list->VtxBuffer.Data),
-            cmd_list->VtxBuffer.Size * sizeof(decltype(cmd_list->VtxBuffer)::value_type));
+    uint32_t vtx_base = 0;
+    for (int k = 0; k < draw_data->CmdListsCount; ++k)
+    {
+        const ImDrawList* cmd_list = draw_data->CmdLists[k];
 
-        auto idx_buffer_data = cmd_list->IdxBuffer.Data;
         for (int cmd_i = 0; cmd_i < cmd_list->CmdBuffer.Size; ++cmd_i)
         {
             const ImDrawCmd* draw_cmd = &cmd_list->CmdBuffer[cmd_i];
-            auto elem_count = static_cast<int>(draw_cmd->ElemCount);
+            if (draw_cmd->UserCallback || draw_cmd->ElemCount == 0)
+                continue;
+
+            CPT(RenderState) state = state_cache_.get_state(
+                draw_cmd->ClipRect,
+                static_cast<Texture*>(draw_cmd->TextureId),
+                fb_width,
+                fb_height);
+
+            // states are unique in Panda's state cache, so a pointer compare is enough
+            if (state != batch_state)
+            {
+                add_batch_geom(batch_state);
+                batch_state = state;
+            }
 
-            if (!(cmd_i < static_cast<int>(geom_list.nodepaths.size())))
-                geom_list.nodepaths.push_back(create_geomnode(geom_list.vdata));
+            const ImDrawIdx* idx_ptr = cmd_list->IdxBuffer.Data + draw_cmd->IdxOffset;
+            const uint32_t offset = vtx_base + draw_cmd->VtxOffset;
+            for (unsigned int i = 0; i < draw_cmd->ElemCount; ++i)
+                index_buffer_.push_back(offset + idx_ptr[i]);
+        }
 
-            NodePath np = geom_list.nodepaths[cmd_i];
-            np.reparent_to(root_);
+        vtx_base += static_cast<uint32_t>(cmd_list->VtxBuffer.Size);
+    }
 
-            auto gn = DCAST(GeomNode, np.node());
+    add_batch_geom(batch_state);
+    return true;
+}
 
-            auto index_handle = gn->modify_geom(0)->modify_primitive(0)->modify_vertices(elem_count)->modify_handle();
-            if (index_handle->get_num_rows() < elem_count)
-                index_handle->unclean_set_num_rows(elem_count);
+void Panda3DImGui::add_batch_geom(const RenderState* state)
+{
+    if (index_buffer_.empty() || state == nullptr)
+        return;
 
-            std::memcpy(
-                index_handle->get_write_pointer(),
-                reinterpret_cast<const unsigned char*>(idx_buffer_data),
-                elem_count * sizeof(decltype(cmd_list->IdxBuffer)::value_type));
-            idx_buffer_data += elem_count;
+    if (!(num_geoms_ < geoms_.size()))
+        geoms_.push_back(create_geom());
 
-            CPT(RenderState) state = RenderState::make(ScissorAttrib::make(
-                draw_cmd->ClipRect.x / fb_width,
-                draw_cmd->ClipRect.z / fb_width,
-                1 - draw_cmd->ClipRect.w / fb_height,
-                1 - draw_cmd->ClipRect.y / fb_height));
+    PT(Geom) geom = geoms_[num_geoms_++];
 
-            if (draw_cmd->TextureId)
-                state = state->add_attrib(TextureAttrib::make(static_cast<Texture*>(draw_cmd->TextureId)));
+    const int elem_count = static_cast<int>(index_buffer_.size());
+    auto index_handle = geom->modify_primitive(0)->modify_vertices(elem_count)->modify_handle();
+    if (index_handle->get_num_rows() < elem_count)
+        index_handle->unclean_set_num_rows(elem_count);
 
-            gn->set_geom_state(0, state);
-        }
-    }
+    std::memcpy(
+        index_handle->get_write_pointer(),
+        reinterpret_cast<const unsigned char*>(index_buffer_.data()),
+        elem_count * sizeof(uint32_t));
 
-    return true;
+    geom_node_->add_geom(geom, state);
+    index_buffer_.clear();
 }
 
 
 void Panda3DImGui::setup_font_texture()
 {
     ImGuiIO& io = ImGui::GetIO();
+    SharedResources& shared = get_shared_resources();
+
+    // Atlas already built and uploaded by another context
+    if (shared.font_texture && io.Fonts->IsBuilt() && io.Fonts->TexID == shared.font_texture.p())
+    {
+        font_texture_ = shared.font_texture;
+        return;
+    }
 
     // Retrieve font texture data from ImGui
     unsigned char* pixels;
     int width, height;
     io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height);
 
-    // Create a new texture for the font
-    font_texture_ = Texture::make_texture();
-    font_texture_->set_name("imgui-font-texture");
+    // Create the shared font texture once, later rebuilds of the atlas reuse it
+    if (!shared.font_texture)
+    {
+        shared.font_texture = Texture::make_texture();
+        shared.font_texture->set_name("imgui-font-texture");
+    }
+    font_texture_ = shared.font_texture;
 
     // Set up a 2D texture with single-channel format for the alpha-only texture
     font_texture_->setup_2d_texture(
@@ -563,33 +739,101 @@ void Panda3DImGui::setup_font_texture()
 }
 */
 
-NodePath Panda3DImGui::create_geomnode(const GeomVertexData* vdata)
+CPT(RenderState) Panda3DImGui::StateCache::get_state(const ImVec4& clip_rect, Texture* texture, float fb_width, float fb_height)
 {
-    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UsageHint::UH_stream);
+    // cached states hold normalized scissor regions, they are stale after a resize
+    if (fb_width != fb_width_ || fb_height != fb_height_)
+    {
+        clear();
+        fb_width_ = fb_width;
+        fb_height_ = fb_height;
+    }
 
-    static_assert(
-        sizeof(ImDrawIdx) == sizeof(uint16_t) ||
-        sizeof(ImDrawIdx) == sizeof(uint32_t),
-        "Type of ImDrawIdx is not uint16_t or uint32_t. Update below code!"
-        );
-    if (sizeof(ImDrawIdx) == sizeof(uint16_t))
-        prim->set_index_type(GeomEnums::NumericType::NT_uint16);
-    else if (sizeof(ImDrawIdx) == sizeof(uint32_t))
-        prim->set_index_type(GeomEnums::NumericType::NT_uint32);
+    // quantize outwards to whole pixels
+    Key key = {
+        static_cast<int>(std::floor(clip_rect.x)),
+        static_cast<int>(std::floor(clip_rect.y)),
+        static_cast<int>(std::ceil(clip_rect.z)),
+        static_cast<int>(std::ceil(clip_rect.w)),
+        texture
+    };
+
+    auto it = lookup_.find(key);
+    if (it != lookup_.end())
+    {
+        ++stats.hits;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->state;
+    }
+
+    ++stats.misses;
+
+    CPT(RenderState) state = RenderState::make(ScissorAttrib::make(
+        key.x0 / fb_width,
+        key.x1 / fb_width,
+        1 - key.y1 / fb_height,
+        1 - key.y0 / fb_height));
+
+    if (texture)
+        state = state->add_attrib(TextureAttrib::make(texture));
+
+    if (entries_.size() >= capacity && !entries_.empty())
+    {
+        lookup_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+
+    entries_.push_front({ key, state });
+    lookup_[key] = entries_.begin();
+
+    return state;
+}
+
+void Panda3DImGui::StateCache::clear()
+{
+    entries_.clear();
+    lookup_.clear();
+}
 
+bool Panda3DImGui::StateCache::Key::operator==(const Key& other) const
+{
+    return x0 == other.x0 && y0 == other.y0 && x1 == other.x1 && y1 == other.y1 && texture == other.texture;
+}
+
+size_t Panda3DImGui::StateCache::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = std::hash<Texture*>()(key.texture);
+    for (int value : { key.x0, key.y0, key.x1, key.y1 })
+        hash ^= std::hash<int>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+PT(Geom) Panda3DImGui::create_geom()
+{
+    // indices are rebased onto the packed vertex buffer of a frame which can exceed
+    // the range of ImDrawIdx, so primitives always use 32 bit indices.
+    PT(GeomTriangles) prim = new GeomTriangles(GeomEnums::UsageHint::UH_stream);
+    prim->set_index_type(GeomEnums::NumericType::NT_uint32);
     prim->close_primitive();
 
-    PT(Geom) geom = new Geom(vdata);
+    PT(Geom) geom = new Geom(vdata_);
     geom->add_primitive(prim);
 
-    PT(GeomNode) geom_node = new GeomNode("imgui-geom");
-    geom_node->add_geom(geom, RenderState::make_empty());
-
-    return NodePath(geom_node);
+    return geom;
 }
 
 void Panda3DImGui::clean_up() {
 
+    if (!context_)
+        return;
+
+    ImGui::SetCurrentContext(context_);
+
+    EventHandler* event_handler = EventHandler::get_global_event_handler();
+    event_handler->remove_hook(BUTTON_DOWN_EVENT_NAME, &Panda3DImGui::on_button_event, this);
+    event_handler->remove_hook(BUTTON_UP_EVENT_NAME, &Panda3DImGui::on_button_event, this);
+    event_handler->remove_hook(KEYSTROKE_EVENT_NAME, &Panda3DImGui::on_keystroke_event, this);
+
 #if defined(__WIN32__) || defined(_WIN32)
     if (enable_file_drop_) {
         if (window_.is_valid_pointer()) {
@@ -606,6 +850,18 @@ void Panda3DImGui::clean_up() {
     io.BackendPlatformUserData = nullptr;
     io.BackendFlags &= ~(ImGuiBackendFlags_HasMouseCursors | ImGuiBackendFlags_HasSetMousePos | ImGuiBackendFlags_HasGamepad);
 
-    ImGui::DestroyContext();
+    ImGui::DestroyContext(context_);
     context_ = nullptr;
+
+    // release shared resources with the last context
+    SharedResources& shared = get_shared_resources();
+    if (--shared.num_contexts == 0)
+    {
+        IM_DELETE(shared.font_atlas);
+        shared.font_atlas = nullptr;
+        shared.font_texture.clear();
+        shared.vformat.clear();
+        shared.shaders.clear();
+        shared.fonts.clear();
+    }
 }
@@ -24,15 +24,29 @@
 
 #pragma once
 
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 class GraphicsWindow;
 class ButtonHandle;
+class ButtonThrower;
+class Event;
 class MouseWatcher;
 class ButtonMap;
 class Texture;
+class Shader;
+class Geom;
+class GeomNode;
+class GeomVertexData;
+class GeomVertexFormat;
+class RenderState;
 class NodePath;
 
 struct ImGuiContext;
+struct ImFontAtlas;
+struct ImVec4;
 
 class Panda3DImGui
 {
@@ -41,6 +55,11 @@ public:
     static constexpr const char* SETUP_CONTEXT_EVENT_NAME = "imgui-setup-context";
     static constexpr const char* DROPFILES_EVENT_NAME     = "imgui-dropfiles";
 
+    // generic events thrown by the ButtonThrower on every button transition / keystroke
+    static constexpr const char* BUTTON_DOWN_EVENT_NAME   = "imgui-button-down";
+    static constexpr const char* BUTTON_UP_EVENT_NAME     = "imgui-button-up";
+    static constexpr const char* KEYSTROKE_EVENT_NAME     = "imgui-keystroke";
+
     enum class Style
     {
         dark = 0,
@@ -48,6 +67,12 @@ public:
         light,
     };
 
+    struct StateCacheStats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
 public:
     Panda3DImGui();
     ~Panda3DImGui();
@@ -59,14 +84,23 @@ public:
     void setup_shader(Shader* shader);
     void setup_font();
     void setup_font(const char* font_filename, float font_size);
-    void setup_event();
+    void setup_event(ButtonThrower* button_thrower);
     void enable_file_drop();
+    bool enable_docking();
 
     void on_window_resized();
     void on_window_resized(const LVecBase2& size);
     void on_button_down_or_up(const ButtonHandle& button, bool down);
     void on_keystroke(wchar_t keycode);
 
+    /**
+     * Stops queuing input events, for contexts that skip their frames for a while.
+     * Events are only consumed by a new frame, so a context that is not updated would
+     * otherwise keep growing its input queue.
+     */
+    void set_input_enabled(bool enabled);
+    bool is_input_enabled() const;
+
     bool new_frame_imgui();
     bool render_imgui();
 
@@ -78,13 +112,16 @@ public:
 
     /** Get mouse position when files are dropped. */
     const LVecBase2& get_dropped_point() const;
+
+    /** Get hit / miss counts of the draw command render state cache. */
+    const StateCacheStats& get_state_cache_stats() const;
+    void reset_state_cache_stats();
 	
 	/** clean up */
 	void clean_up();
 	
 	ImGuiContext* context_ = nullptr;
     MouseWatcher* mouse_watcher = nullptr;
-	std::vector<ButtonHandle> btn_handles;
 	
 	int last_resolution_x;
 	int last_resolution_y;
@@ -92,8 +129,69 @@ public:
 	bool should_repaint;
 
 private:
+    /**
+     * GPU and font resources shared by every Panda3DImGui instance, the font atlas and
+     * its texture, the registered vertex format and the shaders are created on first use
+     * and released when the last context is cleaned up. Fonts and shaders are keyed by
+     * their file and size or directory, so each is loaded once however many contexts ask.
+     */
+    struct SharedResources
+    {
+        ImFontAtlas* font_atlas = nullptr;
+        PT(Texture) font_texture;
+        CPT(GeomVertexFormat) vformat;
+        std::unordered_map<std::string, PT(Shader)> shaders;
+        std::unordered_set<std::string> fonts;
+        int num_contexts = 0;
+    };
+    static SharedResources& get_shared_resources();
+
+    /**
+     * Small LRU of draw command render states keyed by the clip rect quantized to whole
+     * pixels and the texture, so the common states skip RenderState::make and the global
+     * state cache every frame.
+     */
+    class StateCache
+    {
+    public:
+        CPT(RenderState) get_state(const ImVec4& clip_rect, Texture* texture, float fb_width, float fb_height);
+        void clear();
+
+        StateCacheStats stats;
+        size_t capacity = 64;
+
+    private:
+        struct Key
+        {
+            int x0, y0, x1, y1;
+            Texture* texture;
+
+            bool operator==(const Key& other) const;
+        };
+
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const;
+        };
+
+        struct Entry
+        {
+            Key key;
+            CPT(RenderState) state;
+        };
+
+        std::list<Entry> entries_; // most recently used first
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> lookup_;
+        float fb_width_ = 0.0f;
+        float fb_height_ = 0.0f;
+    };
+
+    static void on_button_event(const Event* event, void* data);
+    static void on_keystroke_event(const Event* event, void* data);
+
     void setup_font_texture();
-    NodePath create_geomnode(const GeomVertexData* vdata);
+    void add_batch_geom(const RenderState* state);
+    PT(Geom) create_geom();
 
     WPT(GraphicsWindow) window_;
 	CPT(GeomVertexFormat) vformat_;
@@ -101,16 +199,17 @@ private:
     PT(Texture) font_texture_;
     PT(ButtonMap) button_map_;
 	
-    struct GeomList
-    {
-        PT(GeomVertexData) vdata; // vertex data shared among the below GeomNodes
-        std::vector<NodePath> nodepaths;
-    };
-    std::vector<GeomList> geom_data_;
+    PT(GeomVertexData) vdata_;          // vertices of all draw lists of a frame
+    PT(GeomNode) geom_node_;            // one Geom per batch of draw commands
+    std::vector<PT(Geom)> geoms_;       // Geoms reused across frames
+    size_t num_geoms_ = 0;
+    std::vector<uint32_t> index_buffer_;
+    StateCache state_cache_;
 
     class WindowProc;
     std::unique_ptr<WindowProc> window_proc_;
 	
+    bool input_enabled_ = true;
     bool enable_file_drop_ = false;
     std::vector<Filename> dropped_files_;
     LVecBase2 dropped_point_;
@@ -128,6 +227,11 @@ inline NodePath Panda3DImGui::get_root() const
     return root_;
 }
 
+inline bool Panda3DImGui::is_input_enabled() const
+{
+    return input_enabled_;
+}
+
 inline const std::vector<Filename>& Panda3DImGui::get_dropped_files() const
 {
     return dropped_files_;
@@ -137,3 +241,13 @@ inline const LVecBase2& Panda3DImGui::get_dropped_point() const
 {
     return dropped_point_;
 }
+
+inline const Panda3DImGui::StateCacheStats& Panda3DImGui::get_state_cache_stats() const
+{
+    return state_cache_.stats;
+}
+
+inline void Panda3DImGui::reset_state_cache_stats()
+{
+    state_cache_.stats = StateCacheStats();
+}
@@ -8,17 +8,38 @@
 
 // Forward declarations
 class GeomNode;
+class GraphicsStateGuardian;
 
+// Editor ground grid. When the gsg supports GLSL the grid is a single quad shaded
+// procedurally (see assets/shaders/grid.*), it follows the camera, fades with distance and
+// subdivides with camera height, so it has no extent. Otherwise (no gsg, software renderer)
+// it falls back to NUM_LEVELS prebuilt LineSegs grids, each LEVEL_FACTOR times the size and
+// spacing of the previous one with the base 'grid_size' / 'grid_step' grid second, 'update'
+// crossfades between them by camera distance.
 class AxisGrid : public NodePath {
 public:
     AxisGrid(float grid_size = 100, float grid_step = 10, int sub_divisions = 10);
 	
-    void create();
+    void create(GraphicsStateGuardian* gsg = nullptr);
+    
+    // selects the line grid levels for the scene camera's distance to its target,
+    // the procedural grid needs no update
+    void update(float camera_distance);
+    
+    bool is_procedural() const { return procedural; }
+    
+    static constexpr int   NUM_LEVELS   = 4;
+    static constexpr float LEVEL_FACTOR = 10.0f;
+    
+    // distance from the camera at which the procedural grid has faded out, grows with height
+    float fade_distance;
     
 private:
-    void _draw_grid_lines(float step, LineSegs& line_seg);
-    void _draw_axis(const std::string& axis, LineSegs& line_seg);
-    void _attach_lines(LineSegs& line_seg);
+    bool _create_procedural(GraphicsStateGuardian* gsg);
+    void _create_lines();
+    void _draw_grid_lines(float step, float extent, LineSegs& line_seg);
+    void _draw_axis(const std::string& axis, float extent, LineSegs& line_seg);
+    NodePath _attach_lines(LineSegs& line_seg);
     std::vector<float> _frange(float start, float stop, float step);
 
     float grid_size;
@@ -26,6 +47,7 @@ private:
     int sub_divisions;
 
     bool show_end_cap_lines;
+    bool procedural;
 
     LVecBase4 x_axis_color;
     LVecBase4 y_axis_color;
@@ -37,8 +59,9 @@ private:
     float sub_div_thickness;
 
     LineSegs axis_lines;
-    LineSegs grid_lines;
-    LineSegs sub_division_lines;
+    
+    std::vector<NodePath> levels;
+    float last_lod;
 };
 
 #endif // THREE_AXIS_GRID_H
@@ -1,6 +1,8 @@
 #ifndef CONSTANTS_H
 #define CONSTANTS_H
 
+#include <string>
+
 #include <keyboardButton.h>
 
 enum GameViewStyle {
@@ -21,6 +23,9 @@ constexpr int ENGINE_DR_2D_SORT = 10;
 constexpr int GAME_DR_3D_SORT   = 20;
 constexpr int GAME_DR_2D_SORT   = 30;
 
+// default file of the editor's record / replay hotkeys, see 'InputRecorder'
+const std::string INPUT_RECORDING_PATH = "input_recording.bin";
+
 const int ALT_KEY_IDX  = KeyboardButton::alt().get_index();
 const int CTRL_KEY_IDX = KeyboardButton::control().get_index();
 
@@ -15,7 +15,21 @@ public:
 	struct Settings {
 		GameViewStyle game_view_style;
 		float game_view_size;
+		bool  game_mode_full_window; // expand the game view to the window while in game mode
 	};
+	
+	// wall clock time of the stages of the last 'EngineUpdate', in seconds
+	struct FrameTimings {
+		double engine_update; // input, data graph and events
+		double imgui;
+		double dispatch;      // engine event callbacks
+		double render;
+	};
+	
+	// replaces the interactive loop of 'start', set before 'start' is called, e.g. by the
+	// benchmark runner from a static initializer
+	typedef void (*StartHook)(Demon&);
+	static void set_start_hook(StartHook hook) { start_hook_ = hook; }
 
     // Delete copy constructor and assignment operator
 	// necessary for singleton
@@ -34,6 +48,8 @@ public:
 	void enable_game_mode();
 	void exit_game_mode();
 	bool is_game_mode();
+	const FrameTimings& get_frame_timings() const { return _frame_timings; }
+	void toggle_game_mode_full_window();
 	void increase_game_view_size();
 	void decrease_game_view_size();
 	void update_game_view();
@@ -46,8 +62,8 @@ public:
 	Engine engine;
 	Game game;
 	LevelEditor level_ed;
-	Settings settings = {GameViewStyle::BOTTOM_LEFT, 0.3f};
-	Settings default_settings = {GameViewStyle::BOTTOM_LEFT, 0.3f};
+	Settings settings = {GameViewStyle::BOTTOM_LEFT, 0.3f, true};
+	Settings default_settings = {GameViewStyle::BOTTOM_LEFT, 0.3f, true};
 	
 private:
     Demon();
@@ -61,13 +77,15 @@ private:
 	void init_imgui(Panda3DImGui *panda3d_imgui, NodePath *parent, MouseWatcher* mw, std::string name);
 	void init_imgui_task();
 	void imgui_update();
-	void handle_imgui_mouse(MouseWatcher* mw, Panda3DImGui* panda3d_imgui);
 	
 	// Fields
 	bool _cleaned_up;
 	bool _is_game_mode;
 	bool _mouse_over_ui;
 	int  _num_frames_since_last_repait;
+	FrameTimings _frame_timings;
+	
+	static StartHook start_hook_;
 		
 	// Delete the 'delete' operator to prevent manual deletion
 	// necessary for singleton
@@ -36,9 +36,17 @@
 #include "axisGrid.hpp"
 #include "resourceManager.hpp"
 #include "mouse.hpp"
+#include "inputRecorder.hpp"
 
 class Engine {
 public:
+	// a callback together with the object that registered it, see 'ignore_all'
+	template <typename Callback>
+	struct EventCallback {
+		Callback    callback;
+		const void* owner;
+	};
+	
     Engine();
     ~Engine();
 
@@ -67,23 +75,29 @@ public:
     NodePath              cam2D;
 
     Mouse                 mouse;
+    InputRecorder         input_recorder;
     ResourceManager       resource_manager;
     AxisGrid              axis_grid;
 	
-	std::unordered_map<std::string, std::vector<std::function<void()>>> event_map;
-    std::vector<std::function<void(std::string event_name)>>            unnamed_events;
+	std::unordered_map<std::string, std::vector<EventCallback<std::function<void()>>>> event_map;
+    std::vector<EventCallback<std::function<void(std::string event_name)>>>            unnamed_events;
 	
     bool should_repaint;
 	
     // methods
-	void accept(const std::string& event_name, std::function<void()> callback);
-    void accept(std::function<void(std::string event_name)> callback);
+	void accept(const std::string& event_name, std::function<void()> callback, const void* owner = nullptr);
+    void accept(std::function<void(std::string event_name)> callback, const void* owner = nullptr);
+	void ignore_all(const void* owner);
 	void clean_up();
 	void dispatch_event(std::string evt_name);
 	void dispatch_events(bool ignore_mouse = false);
 	void on_evt_size();
 	void trigger(const std::string& event_name);
 	void update();
+	
+	// editor display regions and the scene camera, turned off in game mode
+	void set_editor_active(bool active);
+	bool is_editor_active() const { return editor_active_; }
 
 	float get_aspect_ratio();
     LVecBase2i get_size();
@@ -100,6 +114,8 @@ private:
 		
 	// cache
 	std::vector<std::pair<CPT_Event, std::vector<void*>>> panda_events;
+	
+	bool editor_active_;
 };
 
 #endif
\ No newline at end of file
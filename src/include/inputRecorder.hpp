@@ -0,0 +1,100 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <string>
+#include <vector>
+
+#include <buttonEvent.h>
+#include <clockObject.h>
+#include <datagramOutputFile.h>
+#include <dataNode.h>
+#include <lvecBase2.h>
+
+#include "mouse.hpp"
+
+class Engine;
+
+// Records the mouse and keyboard input of a session to a binary file and plays it back into
+// 'Engine' frame by frame, so an interactive session (orbiting, marquee selection, game mode)
+// can be repeated exactly, e.g. to benchmark it on a machine nobody sits at.
+//
+// Input is captured where it enters the data graph, between the window's MouseAndKeyboard and
+// the mouse watchers, together with the pointer motion 'Mouse' read and the frame dt. Replay
+// substitutes the recorded data at the same point, so the watchers, button throwers, events
+// and ImGui see exactly what they saw while recording. The global clock is forced to the
+// recorded dt (or a constant 'fixed_dt') during replay, which makes time dependent code
+// independent of how fast the replaying machine is.
+class InputRecorder {
+public:
+    InputRecorder(Engine& engine);
+    ~InputRecorder();
+
+    bool start_recording(const std::string& path);
+    // the whole file is read up front, 'fixed_dt' of 0 replays the recorded frame times
+    bool start_replay(const std::string& path, float fixed_dt = 0.0f);
+    // also called when a replay runs out of frames, ending a replay either way throws
+    // 'input-replay-done' after restoring the clock mode, a limited clock's frame rate is
+    // not restored and has to be set again by its owner, see 'RuntimeScript'
+    void stop();
+
+    bool is_recording() const { return mode_ == Mode::RECORD; }
+    bool is_replaying() const { return mode_ == Mode::REPLAY; }
+    int  get_frame() const { return frame_; }
+    int  get_num_frames() const;
+
+    // sits between MouseAndKeyboard and the mouse watchers, see 'Engine::setup_mouse_keyboard'
+    PandaNode* get_node() const;
+
+    // called by 'Engine::update' around the data graph traversal
+    void begin_frame();
+    void end_frame();
+
+private:
+    class Node;
+
+    enum class Mode { NONE, RECORD, REPLAY };
+
+    struct RecordedButton {
+        std::string       button;  // ButtonHandle name, handles are not stable between runs
+        ButtonEvent::Type type;
+        int               keycode;
+        double            time;
+    };
+
+    struct Frame {
+        float dt = 0.0f;
+
+        // data graph wires, absent while the pointer is outside the window
+        bool       has_pixel_xy = false;
+        bool       has_xy = false;
+        bool       has_pixel_size = false;
+        LVecBase2  pixel_xy;
+        LVecBase2  xy;
+        LVecBase2  pixel_size;
+
+        std::vector<RecordedButton> buttons;
+
+        // what 'Mouse' read directly from the window
+        float pointer_x = 0.0f;
+        float pointer_y = 0.0f;
+        std::vector<Mouse::Motion> motions;
+    };
+
+    Engine&  engine_;
+    PT(Node) node_;
+    Mode     mode_;
+    int      frame_;
+    float    fixed_dt_;
+
+    ClockObject::Mode prev_clock_mode_;  // before the replay
+
+    Frame              current_;
+    std::vector<Frame> frames_;  // replay
+    DatagramOutputFile output_;  // record
+
+    void write_frame(const Frame& frame);
+    bool read_frames(const std::string& path);
+    void apply_clock(int frame);
+};
+
+#endif // INPUT_RECORDER_H
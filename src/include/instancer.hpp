@@ -0,0 +1,75 @@
+#ifndef INSTANCER_H
+#define INSTANCER_H
+
+#include <vector>
+#include <nodePath.h>
+#include <texture.h>
+#include <shader.h>
+#include <lpoint3.h>
+#include <lvecBase3.h>
+#include <luse.h>
+
+class GraphicsStateGuardian;
+
+// Draws many copies of a few prototype models. Per-instance transforms and colors are packed
+// into one buffer texture per prototype and the prototype is drawn once with an instance
+// count, the vertex shader ('assets/shaders/instancing.vert') fetches its own row. When the
+// GSG can't do that (no GLSL or buffer textures, e.g. the software renderer) copies of the
+// prototype are flattened into a single static mesh instead.
+//
+// The instancing shader is unlit, it replaces whatever shader the prototype had.
+class Instancer {
+public:
+    Instancer(GraphicsStateGuardian* gsg);
+    ~Instancer();
+
+    // returns the prototype index, 'model' is copied so the original can be reused or removed
+    int  register_prototype(const NodePath& model, const NodePath& parent);
+    void remove_prototype(int prototype);
+
+    int  add_instance(
+        int prototype,
+        const LPoint3& pos,
+        const LVecBase3& hpr = LVecBase3(0),
+        const LVecBase3& scale = LVecBase3(1),
+        const LColor& color = LColor(1));
+
+    void set_instance_transform(int prototype, int instance, const LPoint3& pos, const LVecBase3& hpr, const LVecBase3& scale);
+    void set_instance_color(int prototype, int instance, const LColor& color);
+    void clear_instances(int prototype);
+
+    int  get_num_instances(int prototype) const;
+    NodePath get_root(int prototype) const;
+    bool is_hardware_instancing() const { return hardware_; }
+
+    // uploads / rebuilds every prototype changed since the last call, call once per frame
+    void update();
+
+private:
+    static constexpr int TEXELS_PER_INSTANCE = 4;
+
+    struct Prototype {
+        NodePath               model;  // private copy, template for the software path
+        NodePath               root;   // what is actually rendered
+        std::vector<LVecBase4f> data;   // packed, TEXELS_PER_INSTANCE per instance
+        PT(Texture)            buffer;
+        LPoint3                center;  // model space bounds of the prototype
+        PN_stdfloat            radius = 0;
+        bool                   dirty = false;
+        bool                   in_use = false;
+    };
+
+    std::vector<Prototype> prototypes_;
+    PT(Shader)             shader_;
+    bool                   hardware_;
+
+    Prototype* get_prototype(int prototype);
+    void write_instance(Prototype& proto, int instance, const LMatrix4& mat);
+    LMatrix4 read_instance(const Prototype& proto, int instance) const;
+
+    void upload(Prototype& proto);
+    void rebuild_flattened(Prototype& proto);
+    void update_bounds(Prototype& proto);
+};
+
+#endif // INSTANCER_H
@@ -0,0 +1,60 @@
+#ifndef LEVEL_OPTIMIZER_H
+#define LEVEL_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+#include <nodePath.h>
+
+struct LevelOptimizerStats {
+    int    nodes_before      = 0;
+    int    nodes_after       = 0;
+    int    geom_nodes_before = 0;
+    int    geom_nodes_after  = 0;
+    int    geoms_before      = 0;  // roughly one draw call each
+    int    geoms_after       = 0;
+    int    collision_nodes   = 0;
+    int    markers           = 0;
+    int    dynamic_nodes     = 0;
+    int    cells             = 0;
+    double seconds           = 0.0;
+
+    void print(const std::string& name) const;
+};
+
+// Restructures a loaded level for rendering. Collision nodes, markers (empty leaf nodes such
+// as spawn points, still found by name afterwards) and dynamic subtrees (tagged, animated,
+// switched or with effects) are moved aside unchanged, the remaining static geometry is
+// grouped into spatial cells and each cell is flattened so geoms sharing a render state
+// become a single draw call while still being culled per cell.
+//
+// Result:
+//   level
+//   ├── collision
+//   ├── markers
+//   ├── dynamic
+//   └── static
+//       └── cell_x_y_z ...
+class LevelOptimizer {
+public:
+    LevelOptimizer(float cell_size = 64.0f);
+
+    LevelOptimizerStats optimize(NodePath level);
+
+    // writes an optimized level to a .bam file, load it back with ResourceManager::load_model
+    static bool bake(const NodePath& level, const std::string& bam_path);
+
+    void set_cell_size(float cell_size) { cell_size_ = cell_size; }
+    // subtrees under nodes carrying this tag are never merged, 'dynamic' is always checked
+    void add_dynamic_tag(const std::string& tag) { dynamic_tags_.push_back(tag); }
+
+private:
+    float                    cell_size_;
+    std::vector<std::string> dynamic_tags_;
+
+    bool is_dynamic(PandaNode* node) const;
+    void separate(const NodePath& level, const NodePath& np,
+                  NodePath& collision, NodePath& markers, NodePath& dynamic,
+                  std::vector<NodePath>& geom_nodes, LevelOptimizerStats& stats) const;
+};
+
+#endif // LEVEL_OPTIMIZER_H
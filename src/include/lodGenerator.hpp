@@ -0,0 +1,42 @@
+#ifndef LOD_GENERATOR_H
+#define LOD_GENERATOR_H
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <nodePath.h>
+
+struct LODSettings {
+    // fraction of triangles kept by each level after the full detail one
+    std::vector<float> ratios       = { 0.5f, 0.25f, 0.1f };
+    // screen height fraction covered by the model's bounding sphere below which the next
+    // level is used, one per entry in 'ratios'
+    std::vector<float> screen_sizes = { 0.5f, 0.2f, 0.08f };
+    // below this screen size nothing is drawn, 0 keeps the last level forever
+    float              cull_screen_size = 0.0f;
+    // vertical field of view the distances are computed for, SceneCam uses 60
+    float              fov = 60.0f;
+    float              max_error = 1e30f;
+};
+
+// Builds an 'LODNode' from a model, level 0 is the model itself and every other level is a
+// copy whose geoms are reduced by 'MeshSimplifier'. Switch distances are derived from the
+// screen size of the model's bounding sphere, so they scale with the model.
+class LODGenerator {
+public:
+    typedef std::function<void(NodePath)> Callback;
+
+    // returns a new detached node, the source model is not modified
+    static NodePath generate(const NodePath& model, const LODSettings& settings = LODSettings());
+
+    // generates on a background task chain and calls 'callback' from the main thread once done
+    static void generate_async(const NodePath& model, const LODSettings& settings, Callback callback);
+
+    // generates and writes the result to a .bam file, load it back with ResourceManager::load_model
+    static bool bake(const NodePath& model, const std::string& bam_path, const LODSettings& settings = LODSettings());
+
+    // camera distance at which a sphere of 'radius' covers 'screen_size' of the screen height
+    static float get_switch_distance(float radius, float screen_size, float fov);
+};
+
+#endif // LOD_GENERATOR_H
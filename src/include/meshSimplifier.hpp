@@ -0,0 +1,18 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <geom.h>
+
+// Reduces the triangle count of a 'Geom' by quadric error metric edge collapses (Garland and
+// Heckbert). Collapses are half-edge, a vertex is always merged into one of its neighbours, so
+// the result only needs a new index buffer and shares the source vertex data. Mesh boundaries
+// and attribute seams (one position, several vertices) are locked to avoid cracks.
+class MeshSimplifier {
+public:
+    // collapse until 'target_ratio' of the triangles are left or the next collapse would
+    // exceed 'max_error' (squared distance in model units), returns the source geom if
+    // it has no triangles
+    static CPT(Geom) simplify(const Geom* geom, float target_ratio, float max_error = 1e30f);
+};
+
+#endif // MESH_SIMPLIFIER_H
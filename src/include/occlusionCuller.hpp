@@ -0,0 +1,101 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <cstdint>
+#include <vector>
+#include <nodePath.h>
+#include <bitMask.h>
+#include <transformState.h>
+
+class AsyncTaskChain;
+
+// Software occlusion culling for a camera, typically 'Game::main_cam'. Occluder meshes are
+// rasterized into a small CPU depth buffer every frame, then the screen rectangle of each
+// occludee's bounding box is tested against it. Occludees that are fully behind occluders
+// are hidden from the camera's draw mask only, other cameras (the editor view) still draw them.
+//
+// Occluders should be big, simple and closed (walls, floors, large props), their triangles
+// are captured in root space when added so they are expected not to move. Rasterization is
+// split into horizontal bands and occludee tests into ranges, both run on a worker chain.
+//
+// Call 'update' once per frame after the camera has moved, e.g. at the end of 'on_update'.
+class OcclusionCuller {
+public:
+    OcclusionCuller(const NodePath& camera, const NodePath& root, int width = 256, int height = 128);
+    ~OcclusionCuller();
+
+    void add_occluder(const NodePath& np);
+    void add_occludee(const NodePath& np);
+    void remove_occludee(const NodePath& np);
+
+    // shows every hidden occludee and forgets occluders and occludees
+    void clear();
+
+    void update();
+
+    // a disabled culler shows everything it hid and does no work
+    void set_enabled(bool enabled);
+    bool is_enabled() const { return enabled_; }
+
+    // 0 rasterizes and tests on the calling thread
+    void set_num_threads(int num_threads);
+
+    int    get_width() const { return width_; }
+    int    get_height() const { return height_; }
+    size_t get_num_occluder_triangles() const { return occluder_points_.size() / 3; }
+    size_t get_num_occludees() const { return occludees_.size(); }
+    int    get_num_occluded() const { return num_occluded_; }  // by the last 'update'
+
+    // normalized depth, 1 is the far plane, rows are 'get_stride' floats apart
+    const std::vector<float>& get_depth_buffer() const { return depth_; }
+    int get_stride() const { return stride_; }
+
+private:
+    struct ScreenTriangle {
+        float x[3], y[3], z[3];
+        bool  valid;
+    };
+
+    struct Occludee {
+        NodePath            np;
+        CPT(TransformState) last_transform;
+        LPoint3             min_point;
+        LPoint3             max_point;
+        bool                has_bounds = false;
+        bool                visible = true;
+        bool                hidden = false;  // hidden by this culler
+    };
+
+    NodePath  camera_;
+    NodePath  root_;
+    BitMask32 camera_mask_;
+    int       width_;
+    int       height_;
+    int       stride_;  // width rounded up to 4 floats
+    bool      enabled_;
+    int       num_threads_;
+    int       num_occluded_;
+    AsyncTaskChain* task_chain_;
+
+    LMatrix4 view_proj_;
+
+    std::vector<LPoint3>        occluder_points_;  // 3 per triangle, root space
+    std::vector<ScreenTriangle> screen_triangles_;
+    std::vector<float>          depth_;
+    std::vector<Occludee>       occludees_;
+
+    void update_bounds(Occludee& occludee);
+
+    void project_triangles(size_t begin, size_t end);
+    void rasterize_band(int y_begin, int y_end);
+    void test_occludees(size_t begin, size_t end);
+    bool is_occluded(const Occludee& occludee) const;
+
+    // runs 'job(begin, end)' over [0, count) split across the worker chain
+    template<class Job>
+    void run_jobs(size_t count, Job job);
+
+    void show_all();
+};
+
+#endif // OCCLUSION_CULLER_H
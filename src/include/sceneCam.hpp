@@ -23,6 +23,7 @@ public:
     void orbit(const LVecBase2f& delta);
     NodePath create_axes(float thickness = 1.0f, float length = 25.0f);
     void update_axes();
+    float get_target_distance() const;
 
 private:
     Engine& engine;
@@ -32,7 +33,7 @@ private:
     NodePath target;
 
     float move_speed;  // move speed of camera
-    float delta_speed; // move speed scaled by ClockObject::get_global_clock()->get_dt()
+    float delta_speed; // move speed per unit of mouse delta
 	
     LVecBase3f default_pos;
 };
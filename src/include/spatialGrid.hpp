@@ -0,0 +1,87 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <nodePath.h>
+#include <transformState.h>
+
+// Restructures the direct children of a flat subtree into a loose grid so the culler can
+// reject whole regions instead of visiting every node:
+//
+//   root
+//   ├── large           objects bigger than the grid's looseness, culled individually
+//   └── region_x_y_z    REGION_CELLS^3 cells each
+//       └── cell_x_y_z  objects whose bounds center falls in the cell
+//
+// Cells are loose, an object only changes cell once its center leaves the cell box grown by
+// 'looseness' on every side. Looseness only decides that, a cell's bounds are computed by
+// Panda from the objects it holds, so they are as tight as its contents. Cells and regions
+// have no transform or state, objects keep theirs. Dynamic objects are re-bucketed by
+// 'update'.
+class SpatialGrid {
+public:
+    SpatialGrid(const NodePath& root, float cell_size = 32.0f, float looseness = 0.5f);
+
+    // moves every current child of root into the grid, children tagged 'dynamic' are tracked
+    void organize();
+
+    void add(NodePath np, bool dynamic = false);
+    void remove(NodePath np);
+
+    // re-buckets dynamic objects that moved out of their loose cell, call once per frame
+    void update();
+
+    // moves every object back under root and removes the cells
+    void clear();
+
+    size_t get_num_cells() const { return cells_.size(); }
+    size_t get_num_objects() const { return objects_.size(); }
+    int    get_num_moved() const { return num_moved_; }  // by the last 'update'
+
+    static constexpr int REGION_CELLS = 8;
+
+private:
+    struct Object {
+        NodePath            np;
+        int64_t             cell = 0;
+        bool                large = false;
+        bool                dynamic = false;
+        CPT(TransformState) last_transform;
+    };
+
+    struct Cell {
+        NodePath np;
+        int64_t  region = 0;
+        int      count = 0;
+    };
+
+    struct Region {
+        NodePath np;
+        int      count = 0;  // cells
+    };
+
+    NodePath root_;
+    NodePath large_;
+    float    cell_size_;
+    float    looseness_;
+    int      num_moved_;
+
+    std::unordered_map<int64_t, Cell>   cells_;
+    std::unordered_map<int64_t, Region> regions_;
+    std::vector<Object>                 objects_;
+
+    static int64_t pack_key(int x, int y, int z);
+    static void    unpack_key(int64_t key, int& x, int& y, int& z);
+
+    bool    calc_world_sphere(const NodePath& np, LPoint3& center, PN_stdfloat& radius) const;
+    int64_t get_cell_key(const LPoint3& center) const;
+    bool    is_inside_loose_cell(int64_t cell, const LPoint3& center) const;
+
+    void place(Object& object);
+    void leave_cell(Object& object);
+    NodePath get_cell(int64_t key);
+};
+
+#endif // SPATIAL_GRID_H
@@ -0,0 +1,54 @@
+#ifndef TRANSFORM_BATCH_H
+#define TRANSFORM_BATCH_H
+
+#include <vector>
+#include <nodePath.h>
+#include <lpoint3.h>
+#include <lquaternion.h>
+#include <asyncTaskChain.h>
+#include <transformState.h>
+
+// Applies the transforms of many nodes in one pass. Positions, rotations and scales are kept
+// in parallel arrays indexed by the order nodes were added, 'commit' turns them into
+// 'TransformState's (optionally spread over worker threads) and then sets them on the
+// nodes from the calling thread, skipping nodes whose transform did not change.
+class TransformBatch {
+public:
+    TransformBatch();
+    ~TransformBatch();
+
+    size_t add(const NodePath& np);
+    // doesn't read the node, for callers that overwrite the arrays before 'commit' anyway
+    size_t add(const NodePath& np, const LPoint3& pos, const LQuaternion& quat, const LVecBase3& scale);
+    void   clear();
+    void   reserve(size_t count);
+    size_t size() const { return nodes_.size(); }
+
+    void set(size_t i, const LPoint3& pos, const LQuaternion& quat);
+    void set(size_t i, const LPoint3& pos, const LQuaternion& quat, const LVecBase3& scale);
+
+    // copies the nodes' current transforms into the arrays
+    void read();
+    void commit();
+
+    // number of worker threads used to build transform states, 0 builds them on the calling
+    // thread which is the default, worthwhile only for several thousand nodes.
+    void set_num_threads(int num_threads);
+    int  get_num_threads() const { return num_threads_; }
+
+    std::vector<LPoint3>     positions;
+    std::vector<LQuaternion> quats;
+    std::vector<LVecBase3>   scales;
+
+private:
+    std::vector<NodePath>            nodes_;
+    std::vector<CPT(TransformState)> states_;
+
+    int             num_threads_;
+    AsyncTaskChain* task_chain_;
+
+    void build_states(size_t begin, size_t end);
+    void build_states_parallel();
+};
+
+#endif // TRANSFORM_BATCH_H
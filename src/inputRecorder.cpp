@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <iostream>
+
+#include <buttonEventList.h>
+#include <buttonRegistry.h>
+#include <clockObject.h>
+#include <dataNodeTransmit.h>
+#include <datagramInputFile.h>
+#include <datagramIterator.h>
+#include <linmath_events.h>
+#include <pointerEventList.h>
+#include <throw_event.h>
+
+#include "engine.hpp"
+#include "inputRecorder.hpp"
+
+// bumped whenever the frame layout changes, old recordings are rejected
+static const std::string FILE_HEADER = "PEINPUT1";
+
+// smallest replayed frame time, a forced clock needs a finite frame rate
+static const float MIN_DT = 1e-4f;
+
+// ----------------------------------------------------------------------------------------- //
+// Data graph node that passes MouseAndKeyboard's output through while recording and replaces
+// it with the recorded frame while replaying.
+class InputRecorder::Node : public DataNode {
+public:
+    Node(InputRecorder& recorder);
+
+    static TypeHandle get_class_type() { return _type_handle; }
+    static void init_type() {
+        if (_type_handle != TypeHandle::none())
+            return;
+
+        DataNode::init_type();
+        register_type(_type_handle, "InputRecorderNode", DataNode::get_class_type());
+    }
+
+    virtual TypeHandle get_type() const { return get_class_type(); }
+    virtual TypeHandle force_init_type() { init_type(); return get_class_type(); }
+
+protected:
+    virtual void do_transmit_data(DataGraphTraverser* trav, const DataNodeTransmit& input, DataNodeTransmit& output);
+
+private:
+    enum Wire { PIXEL_XY, XY, PIXEL_SIZE, BUTTON_EVENTS, POINTER_EVENTS, NUM_WIRES };
+
+    InputRecorder& recorder_;
+    int inputs_[NUM_WIRES];
+    int outputs_[NUM_WIRES];
+
+    PT(EventStoreVec2)  pixel_xy_;
+    PT(EventStoreVec2)  xy_;
+    PT(EventStoreVec2)  pixel_size_;
+    PT(ButtonEventList) button_events_;
+
+    void record(const DataNodeTransmit& input, Frame& frame) const;
+    void replay(const Frame& frame, DataNodeTransmit& output);
+
+    static TypeHandle _type_handle;
+};
+
+TypeHandle InputRecorder::Node::_type_handle;
+
+InputRecorder::Node::Node(InputRecorder& recorder) :
+    DataNode("InputRecorder"),
+    recorder_(recorder),
+    pixel_xy_(new EventStoreVec2(LPoint2(0))),
+    xy_(new EventStoreVec2(LPoint2(0))),
+    pixel_size_(new EventStoreVec2(LPoint2(0))),
+    button_events_(new ButtonEventList) {
+
+    // same wires as MouseAndKeyboard, so the watchers can't tell the difference
+    static const char* names[NUM_WIRES] = { "pixel_xy", "xy", "pixel_size", "button_events", "pointer_events" };
+    const TypeHandle types[NUM_WIRES] = {
+        EventStoreVec2::get_class_type(),
+        EventStoreVec2::get_class_type(),
+        EventStoreVec2::get_class_type(),
+        ButtonEventList::get_class_type(),
+        PointerEventList::get_class_type()
+    };
+
+    for (int i = 0; i < NUM_WIRES; ++i) {
+        inputs_[i]  = define_input(names[i], types[i]);
+        outputs_[i] = define_output(names[i], types[i]);
+    }
+}
+
+void InputRecorder::Node::do_transmit_data(DataGraphTraverser*, const DataNodeTransmit& input, DataNodeTransmit& output) {
+    if (recorder_.is_replaying()) {
+        replay(recorder_.frames_[recorder_.frame_], output);
+        return;
+    }
+
+    for (int i = 0; i < NUM_WIRES; ++i) {
+        if (input.has_data(inputs_[i]))
+            output.set_data(outputs_[i], input.get_data(inputs_[i]));
+    }
+
+    if (recorder_.is_recording())
+        record(input, recorder_.current_);
+}
+
+void InputRecorder::Node::record(const DataNodeTransmit& input, Frame& frame) const {
+    auto read_vec2 = [&input](int wire, LVecBase2& value) {
+        if (!input.has_data(wire))
+            return false;
+
+        value = DCAST(EventStoreVec2, input.get_data(wire).get_ptr())->get_value();
+        return true;
+    };
+
+    frame.has_pixel_xy   = read_vec2(inputs_[PIXEL_XY], frame.pixel_xy);
+    frame.has_xy         = read_vec2(inputs_[XY], frame.xy);
+    frame.has_pixel_size = read_vec2(inputs_[PIXEL_SIZE], frame.pixel_size);
+
+    if (!input.has_data(inputs_[BUTTON_EVENTS]))
+        return;
+
+    const ButtonEventList* events = DCAST(ButtonEventList, input.get_data(inputs_[BUTTON_EVENTS]).get_ptr());
+    for (int i = 0; i < events->get_num_events(); ++i) {
+        const ButtonEvent& event = events->get_event(i);
+
+        // IME candidates and moves carry no button state
+        if (event.get_type() == ButtonEvent::T_candidate || event.get_type() == ButtonEvent::T_move)
+            continue;
+
+        frame.buttons.push_back({ event.get_button().get_name(), event.get_type(), event.get_keycode(), event.get_time() });
+    }
+}
+
+void InputRecorder::Node::replay(const Frame& frame, DataNodeTransmit& output) {
+    if (frame.has_pixel_xy) {
+        pixel_xy_->set_value(frame.pixel_xy);
+        output.set_data(outputs_[PIXEL_XY], EventParameter(pixel_xy_));
+    }
+
+    if (frame.has_xy) {
+        xy_->set_value(frame.xy);
+        output.set_data(outputs_[XY], EventParameter(xy_));
+    }
+
+    if (frame.has_pixel_size) {
+        pixel_size_->set_value(frame.pixel_size);
+        output.set_data(outputs_[PIXEL_SIZE], EventParameter(pixel_size_));
+    }
+
+    if (frame.buttons.empty())
+        return;
+
+    button_events_ = new ButtonEventList;
+    for (const RecordedButton& button : frame.buttons) {
+        if (button.type == ButtonEvent::T_keystroke)
+            button_events_->add_event(ButtonEvent(button.keycode, button.time));
+        else
+            button_events_->add_event(ButtonEvent(ButtonRegistry::ptr()->find_button(button.button), button.type, button.time));
+    }
+
+    output.set_data(outputs_[BUTTON_EVENTS], EventParameter(button_events_));
+}
+
+// ----------------------------------------------------------------------------------------- //
+InputRecorder::InputRecorder(Engine& engine) :
+    engine_(engine),
+    mode_(Mode::NONE),
+    frame_(0),
+    fixed_dt_(0.0f),
+    prev_clock_mode_(ClockObject::M_normal) {
+
+    Node::init_type();
+    node_ = new Node(*this);
+}
+
+InputRecorder::~InputRecorder() {
+    stop();
+}
+
+bool InputRecorder::start_recording(const std::string& path) {
+    stop();
+
+    if (!output_.open(Filename::from_os_specific(path)) || !output_.write_header(FILE_HEADER)) {
+        std::cerr << "InputRecorder: unable to write " << path << std::endl;
+        output_.close();
+        return false;
+    }
+
+    mode_ = Mode::RECORD;
+    frame_ = 0;
+    std::cout << "InputRecorder: recording to " << path << std::endl;
+    return true;
+}
+
+bool InputRecorder::start_replay(const std::string& path, float fixed_dt) {
+    stop();
+
+    if (!read_frames(path))
+        return false;
+
+    mode_ = Mode::REPLAY;
+    frame_ = 0;
+    fixed_dt_ = fixed_dt;
+    engine_.mouse.set_replaying(true);
+
+    // put back by 'stop', the rate of a limited clock is not, the clock only reports its
+    // measured average, so whoever set it re-applies it on 'input-replay-done'
+    prev_clock_mode_ = ClockObject::get_global_clock()->get_mode();
+
+    // the first replayed frame already runs on the recorded clock
+    apply_clock(0);
+
+    std::cout << "InputRecorder: replaying " << frames_.size() << " frames from " << path << std::endl;
+    return true;
+}
+
+void InputRecorder::stop() {
+    if (mode_ == Mode::RECORD) {
+        output_.close();
+        std::cout << "InputRecorder: recorded " << frame_ << " frames" << std::endl;
+    }
+    else if (mode_ == Mode::REPLAY) {
+        frames_.clear();
+        engine_.mouse.set_replaying(false);
+        ClockObject::get_global_clock()->set_mode(prev_clock_mode_);
+        throw_event("input-replay-done");
+    }
+
+    mode_ = Mode::NONE;
+}
+
+int InputRecorder::get_num_frames() const {
+    return is_replaying() ? static_cast<int>(frames_.size()) : frame_;
+}
+
+PandaNode* InputRecorder::get_node() const {
+    return node_;
+}
+
+void InputRecorder::begin_frame() {
+    if (mode_ == Mode::RECORD) {
+        current_ = Frame();
+        current_.dt = static_cast<float>(ClockObject::get_global_clock()->get_dt());
+
+        const MouseData pointer = engine_.win->get_pointer(0);
+        current_.pointer_x = static_cast<float>(pointer.get_x());
+        current_.pointer_y = static_cast<float>(pointer.get_y());
+        current_.motions = engine_.mouse.get_pending_motion();
+    }
+    else if (mode_ == Mode::REPLAY) {
+        if (frame_ >= static_cast<int>(frames_.size())) {
+            stop();
+            return;
+        }
+
+        const Frame& frame = frames_[frame_];
+        engine_.mouse.replay(frame.pointer_x, frame.pointer_y, frame.motions);
+    }
+}
+
+void InputRecorder::end_frame() {
+    if (mode_ == Mode::RECORD) {
+        write_frame(current_);
+        ++frame_;
+    }
+    else if (mode_ == Mode::REPLAY) {
+        ++frame_;
+        apply_clock(frame_);
+    }
+}
+
+void InputRecorder::write_frame(const Frame& frame) {
+    Datagram dg;
+    dg.add_float32(frame.dt);
+
+    const uint8_t wires = (frame.has_pixel_xy ? 1 : 0) | (frame.has_xy ? 2 : 0) | (frame.has_pixel_size ? 4 : 0);
+    dg.add_uint8(wires);
+
+    auto add_vec2 = [&dg](const LVecBase2& value) {
+        dg.add_float32(static_cast<float>(value[0]));
+        dg.add_float32(static_cast<float>(value[1]));
+    };
+
+    if (frame.has_pixel_xy)   add_vec2(frame.pixel_xy);
+    if (frame.has_xy)         add_vec2(frame.xy);
+    if (frame.has_pixel_size) add_vec2(frame.pixel_size);
+
+    dg.add_uint16(static_cast<uint16_t>(frame.buttons.size()));
+    for (const RecordedButton& button : frame.buttons) {
+        dg.add_string(button.button);
+        dg.add_uint8(static_cast<uint8_t>(button.type));
+        dg.add_int32(button.keycode);
+        dg.add_float64(button.time);
+    }
+
+    dg.add_float32(frame.pointer_x);
+    dg.add_float32(frame.pointer_y);
+
+    dg.add_uint16(static_cast<uint16_t>(std::min<size_t>(frame.motions.size(), 0xffff)));
+    for (size_t i = 0; i < frame.motions.size() && i < 0xffff; ++i) {
+        dg.add_float32(frame.motions[i].dx);
+        dg.add_float32(frame.motions[i].dy);
+        dg.add_float64(frame.motions[i].time);
+    }
+
+    if (!output_.put_datagram(dg)) {
+        std::cerr << "InputRecorder: write failed, recording stopped" << std::endl;
+        stop();
+    }
+}
+
+bool InputRecorder::read_frames(const std::string& path) {
+    DatagramInputFile input;
+    std::string header;
+    if (!input.open(Filename::from_os_specific(path)) ||
+        !input.read_header(header, FILE_HEADER.size()) || header != FILE_HEADER) {
+        std::cerr << "InputRecorder: " << path << " is not an input recording" << std::endl;
+        return false;
+    }
+
+    frames_.clear();
+
+    Datagram dg;
+    while (input.get_datagram(dg)) {
+        DatagramIterator scan(dg);
+        Frame frame;
+        frame.dt = scan.get_float32();
+
+        const uint8_t wires = scan.get_uint8();
+        auto get_vec2 = [&scan]() {
+            const float x = scan.get_float32();
+            const float y = scan.get_float32();
+            return LVecBase2(x, y);
+        };
+
+        frame.has_pixel_xy   = (wires & 1) != 0;
+        frame.has_xy         = (wires & 2) != 0;
+        frame.has_pixel_size = (wires & 4) != 0;
+        if (frame.has_pixel_xy)   frame.pixel_xy = get_vec2();
+        if (frame.has_xy)         frame.xy = get_vec2();
+        if (frame.has_pixel_size) frame.pixel_size = get_vec2();
+
+        frame.buttons.resize(scan.get_uint16());
+        for (RecordedButton& button : frame.buttons) {
+            button.button  = scan.get_string();
+            button.type    = static_cast<ButtonEvent::Type>(scan.get_uint8());
+            button.keycode = scan.get_int32();
+            button.time    = scan.get_float64();
+        }
+
+        frame.pointer_x = scan.get_float32();
+        frame.pointer_y = scan.get_float32();
+
+        frame.motions.resize(scan.get_uint16());
+        for (Mouse::Motion& motion : frame.motions) {
+            motion.dx   = scan.get_float32();
+            motion.dy   = scan.get_float32();
+            motion.time = scan.get_float64();
+        }
+
+        frames_.push_back(std::move(frame));
+    }
+
+    input.close();
+    return !frames_.empty();
+}
+
+void InputRecorder::apply_clock(int frame) {
+    if (frame >= static_cast<int>(frames_.size()))
+        return;
+
+    // a forced clock advances by exactly 1 / frame rate per tick, however long the frame took
+    const float dt = std::max(fixed_dt_ > 0.0f ? fixed_dt_ : frames_[frame].dt, MIN_DT);
+    ClockObject* clock = ClockObject::get_global_clock();
+    clock->set_mode(ClockObject::M_forced);
+    clock->set_frame_rate(1.0 / dt);
+}
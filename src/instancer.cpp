@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include <graphicsStateGuardian.h>
+#include <boundingBox.h>
+#include <compose_matrix.h>
+#include <pandaNode.h>
+
+#include "instancer.hpp"
+
+Instancer::Instancer(GraphicsStateGuardian* gsg) : hardware_(false) {
+    if (gsg && gsg->get_supports_glsl() && gsg->get_supports_buffer_texture()) {
+        shader_ = Shader::load(Shader::SL_GLSL, "assets/shaders/instancing.vert", "assets/shaders/instancing.frag");
+        hardware_ = shader_ != nullptr;
+    }
+
+    if (!hardware_)
+        std::cout << "Instancer: hardware instancing not supported, flattening instances on the CPU" << std::endl;
+}
+
+Instancer::~Instancer() {
+    for (size_t i = 0; i < prototypes_.size(); ++i)
+        remove_prototype(static_cast<int>(i));
+}
+
+int Instancer::register_prototype(const NodePath& model, const NodePath& parent) {
+    Prototype proto;
+    proto.in_use = true;
+    proto.model = model.copy_to(NodePath());
+    proto.model.clear_transform();
+    // the shader applies the instance matrix in each Geom's own space, collapsing the child
+    // transforms makes that the prototype root's space, as the bounds and the fallback assume
+    proto.model.flatten_strong();
+    proto.root = parent.attach_new_node("Instances-" + model.get_name());
+
+    LPoint3 min_point, max_point;
+    if (proto.model.calc_tight_bounds(min_point, max_point)) {
+        proto.center = (min_point + max_point) * 0.5f;
+        proto.radius = (max_point - min_point).length() * 0.5f;
+    }
+
+    if (hardware_) {
+        proto.model.instance_to(proto.root);
+
+        proto.buffer = new Texture("InstanceData-" + model.get_name());
+        proto.buffer->setup_buffer_texture(TEXELS_PER_INSTANCE, Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+
+        proto.root.set_shader(shader_, 1);
+        proto.root.set_shader_input("instance_data", proto.buffer);
+        proto.root.set_instance_count(0);
+
+        // culling is done against the bounds of all instances, see 'update_bounds'
+        proto.root.node()->set_final(true);
+    }
+
+    proto.root.hide();
+
+    // reuse a removed slot if there is one
+    for (size_t i = 0; i < prototypes_.size(); ++i) {
+        if (!prototypes_[i].in_use) {
+            prototypes_[i] = proto;
+            return static_cast<int>(i);
+        }
+    }
+
+    prototypes_.push_back(proto);
+    return static_cast<int>(prototypes_.size() - 1);
+}
+
+void Instancer::remove_prototype(int prototype) {
+    Prototype* proto = get_prototype(prototype);
+    if (!proto)
+        return;
+
+    proto->root.remove_node();
+    proto->model.remove_node();
+    proto->data.clear();
+    proto->buffer.clear();
+    proto->in_use = false;
+}
+
+int Instancer::add_instance(
+    int prototype,
+    const LPoint3& pos,
+    const LVecBase3& hpr,
+    const LVecBase3& scale,
+    const LColor& color) {
+
+    Prototype* proto = get_prototype(prototype);
+    if (!proto)
+        return -1;
+
+    int instance = static_cast<int>(proto->data.size()) / TEXELS_PER_INSTANCE;
+    proto->data.resize(proto->data.size() + TEXELS_PER_INSTANCE);
+
+    set_instance_transform(prototype, instance, pos, hpr, scale);
+    set_instance_color(prototype, instance, color);
+    return instance;
+}
+
+void Instancer::set_instance_transform(int prototype, int instance, const LPoint3& pos, const LVecBase3& hpr, const LVecBase3& scale) {
+    Prototype* proto = get_prototype(prototype);
+    if (!proto || instance < 0 || instance >= get_num_instances(prototype))
+        return;
+
+    LMatrix4 mat;
+    compose_matrix(mat, scale, LVecBase3(0), hpr, pos);
+    write_instance(*proto, instance, mat);
+    proto->dirty = true;
+}
+
+void Instancer::set_instance_color(int prototype, int instance, const LColor& color) {
+    Prototype* proto = get_prototype(prototype);
+    if (!proto || instance < 0 || instance >= get_num_instances(prototype))
+        return;
+
+    proto->data[instance * TEXELS_PER_INSTANCE + 3] = LCAST(float, color);
+    proto->dirty = true;
+}
+
+void Instancer::clear_instances(int prototype) {
+    Prototype* proto = get_prototype(prototype);
+    if (!proto)
+        return;
+
+    proto->data.clear();
+    proto->dirty = true;
+}
+
+int Instancer::get_num_instances(int prototype) const {
+    if (prototype < 0 || prototype >= static_cast<int>(prototypes_.size()) || !prototypes_[prototype].in_use)
+        return 0;
+    return static_cast<int>(prototypes_[prototype].data.size()) / TEXELS_PER_INSTANCE;
+}
+
+NodePath Instancer::get_root(int prototype) const {
+    if (prototype < 0 || prototype >= static_cast<int>(prototypes_.size()))
+        return NodePath();
+    return prototypes_[prototype].root;
+}
+
+void Instancer::update() {
+    for (Prototype& proto : prototypes_) {
+        if (!proto.in_use || !proto.dirty)
+            continue;
+
+        if (hardware_)
+            upload(proto);
+        else
+            rebuild_flattened(proto);
+
+        if (proto.data.empty())
+            proto.root.hide();
+        else
+            proto.root.show();
+
+        proto.dirty = false;
+    }
+}
+
+Instancer::Prototype* Instancer::get_prototype(int prototype) {
+    if (prototype < 0 || prototype >= static_cast<int>(prototypes_.size()) || !prototypes_[prototype].in_use)
+        return nullptr;
+    return &prototypes_[prototype];
+}
+
+void Instancer::write_instance(Prototype& proto, int instance, const LMatrix4& mat) {
+    // Panda multiplies row vectors (v * M), store the columns so the shader can use dot products
+    LVecBase4f* rows = &proto.data[instance * TEXELS_PER_INSTANCE];
+    for (int i = 0; i < 3; ++i)
+        rows[i] = LVecBase4f(mat(0, i), mat(1, i), mat(2, i), mat(3, i));
+}
+
+LMatrix4 Instancer::read_instance(const Prototype& proto, int instance) const {
+    const LVecBase4f* rows = &proto.data[instance * TEXELS_PER_INSTANCE];
+    return LMatrix4(
+        rows[0][0], rows[1][0], rows[2][0], 0,
+        rows[0][1], rows[1][1], rows[2][1], 0,
+        rows[0][2], rows[1][2], rows[2][2], 0,
+        rows[0][3], rows[1][3], rows[2][3], 1);
+}
+
+void Instancer::upload(Prototype& proto) {
+    const int num_instances = static_cast<int>(proto.data.size()) / TEXELS_PER_INSTANCE;
+    const int num_texels = std::max(num_instances, 1) * TEXELS_PER_INSTANCE;
+
+    // grow geometrically so adding instances one by one doesn't reallocate every frame
+    if (proto.buffer->get_x_size() < num_texels)
+        proto.buffer->setup_buffer_texture(
+            std::max(num_texels, proto.buffer->get_x_size() * 2), Texture::T_float, Texture::F_rgba32, GeomEnums::UH_dynamic);
+
+    if (num_instances > 0) {
+        PTA_uchar image = proto.buffer->modify_ram_image();
+        std::memcpy(image.p(), proto.data.data(), proto.data.size() * sizeof(LVecBase4f));
+    }
+
+    proto.root.set_instance_count(num_instances);
+    update_bounds(proto);
+}
+
+void Instancer::rebuild_flattened(Prototype& proto) {
+    proto.root.node()->remove_all_children();
+
+    const int num_instances = static_cast<int>(proto.data.size()) / TEXELS_PER_INSTANCE;
+    for (int i = 0; i < num_instances; ++i) {
+        NodePath copy = proto.model.copy_to(proto.root);
+        copy.set_mat(read_instance(proto, i));
+        copy.set_color_scale(LCAST(PN_stdfloat, proto.data[i * TEXELS_PER_INSTANCE + 3]));
+    }
+
+    // bakes transforms and color scales into the vertices and merges the copies
+    proto.root.flatten_strong();
+}
+
+void Instancer::update_bounds(Prototype& proto) {
+    const int num_instances = static_cast<int>(proto.data.size()) / TEXELS_PER_INSTANCE;
+    if (num_instances == 0)
+        return;
+
+    LPoint3 min_point( 1e30f);
+    LPoint3 max_point(-1e30f);
+
+    for (int i = 0; i < num_instances; ++i) {
+        LMatrix4 mat = read_instance(proto, i);
+
+        PN_stdfloat max_scale = std::max(mat.get_row3(0).length(), std::max(mat.get_row3(1).length(), mat.get_row3(2).length()));
+        LVecBase3 extent(proto.radius * max_scale);
+        LPoint3 center = mat.xform_point(proto.center);
+
+        min_point = min_point.fmin(center - extent);
+        max_point = max_point.fmax(center + extent);
+    }
+
+    proto.root.node()->set_bounds(new BoundingBox(min_point, max_point));
+}
@@ -18,11 +18,18 @@ void LevelEditor::init() {
 std::vector<NodePath> LevelEditor::get_selected_nps() { return selected_nps; }
 
 void LevelEditor::on_mouse() {
+	// picking traverses the game scene, nothing to select while playing
+	if (demon.is_game_mode())
+		return;
+	
 	this->mouse_picker.update();
 	this->marquee.on_start();
 }
 
 void LevelEditor::on_mouse_up() {
+	if (demon.is_game_mode())
+		return;
+	
 	marquee.on_stop();
 
 	// get selected nodes
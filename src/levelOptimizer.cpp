@@ -0,0 +1,175 @@
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <tuple>
+
+#include <clockObject.h>
+#include <collisionNode.h>
+#include <geomNode.h>
+#include <lodNode.h>
+#include <switchNode.h>
+#include <sequenceNode.h>
+#include <character.h>
+#include <animBundleNode.h>
+#include <nodePathCollection.h>
+#include <filename.h>
+
+#include "levelOptimizer.hpp"
+
+namespace {
+    int count_nodes(const NodePath& np) {
+        return np.count_num_descendants() + 1;
+    }
+
+    void count_geoms(const NodePath& np, int& geom_nodes, int& geoms) {
+        NodePathCollection collection = np.find_all_matches("**/+GeomNode");
+        geom_nodes = collection.get_num_paths();
+        geoms = 0;
+        for (int i = 0; i < collection.get_num_paths(); ++i)
+            geoms += DCAST(GeomNode, collection.get_path(i).node())->get_num_geoms();
+    }
+
+    // moves 'np' under 'parent' keeping its transform and the state it inherited from 'level'
+    void move_keep_state(NodePath np, const NodePath& parent, const NodePath& level) {
+        CPT(RenderState) state = np.get_state(level);
+        np.wrt_reparent_to(parent);
+        np.set_state(state);
+    }
+}
+
+void LevelOptimizerStats::print(const std::string& name) const {
+    std::cout << "-- Level optimized: " << name << " (" << seconds * 1000.0 << " ms)" << std::endl
+              << "   nodes:      " << nodes_before << " -> " << nodes_after << std::endl
+              << "   geom nodes: " << geom_nodes_before << " -> " << geom_nodes_after << std::endl
+              << "   geoms:      " << geoms_before << " -> " << geoms_after << std::endl
+              << "   cells: " << cells << ", collision nodes: " << collision_nodes
+              << ", markers: " << markers << ", dynamic: " << dynamic_nodes << std::endl;
+}
+
+LevelOptimizer::LevelOptimizer(float cell_size) : cell_size_(cell_size) {
+    dynamic_tags_.push_back("dynamic");
+}
+
+LevelOptimizerStats LevelOptimizer::optimize(NodePath level) {
+    LevelOptimizerStats stats;
+    if (level.is_empty())
+        return stats;
+
+    ClockObject* clock = ClockObject::get_global_clock();
+    double start_time = clock->get_real_time();
+
+    stats.nodes_before = count_nodes(level);
+    count_geoms(level, stats.geom_nodes_before, stats.geoms_before);
+
+    // the groups are created under the level first, moving nodes keeps their
+    // transforms relative to it
+    NodePathCollection source = level.get_children();
+    NodePath collision = level.attach_new_node("collision");
+    NodePath markers   = level.attach_new_node("markers");
+    NodePath dynamic   = level.attach_new_node("dynamic");
+    NodePath statics   = level.attach_new_node("static");
+
+    // 1. pull everything that must survive unchanged out of the hierarchy
+    std::vector<NodePath> geom_nodes;
+    for (int i = 0; i < source.get_num_paths(); ++i)
+        separate(level, source.get_path(i), collision, markers, dynamic, geom_nodes, stats);
+
+    // 2. bucket static geometry into cells by the center of its bounds, children are
+    // listed before their parents so each node is moved off an intact parent chain
+    std::map<std::tuple<int, int, int>, NodePath> cells;
+    for (NodePath& np : geom_nodes) {
+        LPoint3 min_point, max_point;
+        LPoint3 center(0);
+        if (np.calc_tight_bounds(min_point, max_point, level))
+            center = (min_point + max_point) * 0.5f;
+
+        std::tuple<int, int, int> key(
+            static_cast<int>(std::floor(center[0] / cell_size_)),
+            static_cast<int>(std::floor(center[1] / cell_size_)),
+            static_cast<int>(std::floor(center[2] / cell_size_)));
+
+        NodePath& cell = cells[key];
+        if (cell.is_empty()) {
+            cell = statics.attach_new_node(
+                "cell_" + std::to_string(std::get<0>(key)) + "_" +
+                std::to_string(std::get<1>(key)) + "_" + std::to_string(std::get<2>(key)));
+        }
+
+        move_keep_state(np, cell, level);
+    }
+
+    // 3. drop what is left of the source hierarchy, the level's own transform and state are kept
+    for (int i = 0; i < source.get_num_paths(); ++i) {
+        NodePath np = source.get_path(i);
+        if (np.get_parent() == level)
+            np.remove_node();
+    }
+
+    // 4. merge geoms with the same state, per cell
+    for (auto& it : cells)
+        it.second.flatten_strong();
+
+    stats.cells = static_cast<int>(cells.size());
+    stats.nodes_after = count_nodes(level);
+    count_geoms(level, stats.geom_nodes_after, stats.geoms_after);
+    stats.seconds = clock->get_real_time() - start_time;
+    return stats;
+}
+
+bool LevelOptimizer::bake(const NodePath& level, const std::string& bam_path) {
+    return level.write_bam_file(Filename::from_os_specific(bam_path));
+}
+
+bool LevelOptimizer::is_dynamic(PandaNode* node) const {
+    if (node->is_of_type(LODNode::get_class_type()) ||
+        node->is_of_type(SwitchNode::get_class_type()) ||
+        node->is_of_type(SequenceNode::get_class_type()) ||
+        node->is_of_type(Character::get_class_type()) ||
+        node->is_of_type(AnimBundleNode::get_class_type()))
+        return true;
+
+    // billboards, compass and decal effects depend on the node's own transform
+    if (!node->get_effects()->is_empty())
+        return true;
+
+    for (const std::string& tag : dynamic_tags_) {
+        if (node->has_tag(tag))
+            return true;
+    }
+
+    return false;
+}
+
+void LevelOptimizer::separate(
+    const NodePath& level, const NodePath& np,
+    NodePath& collision, NodePath& markers, NodePath& dynamic,
+    std::vector<NodePath>& geom_nodes, LevelOptimizerStats& stats) const {
+
+    PandaNode* node = np.node();
+
+    if (node->is_of_type(CollisionNode::get_class_type())) {
+        move_keep_state(np, collision, level);
+        ++stats.collision_nodes;
+        return;
+    }
+
+    if (is_dynamic(node)) {
+        move_keep_state(np, dynamic, level);
+        ++stats.dynamic_nodes;
+        return;
+    }
+
+    // iterate over a copy, children are moved away while walking
+    NodePathCollection children = np.get_children();
+    for (int i = 0; i < children.get_num_paths(); ++i)
+        separate(level, children.get_path(i), collision, markers, dynamic, geom_nodes, stats);
+
+    if (node->is_geom_node()) {
+        // the children were moved above, only the node's own geoms are merged
+        geom_nodes.push_back(np);
+    }
+    else if (children.get_num_paths() == 0 && !np.get_name().empty()) {
+        move_keep_state(np, markers, level);
+        ++stats.markers;
+    }
+}
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <cmath>
+
+#include <asyncTaskManager.h>
+#include <boundingSphere.h>
+#include <geomNode.h>
+#include <lodNode.h>
+#include <nodePathCollection.h>
+#include <filename.h>
+
+#include "taskUtils.hpp"
+#include "meshSimplifier.hpp"
+#include "lodGenerator.hpp"
+
+static const char* TASK_CHAIN_NAME = "LODGeneratorChain";
+
+static void simplify_geoms(GeomNode* geom_node, const LODSettings& settings, float ratio) {
+    for (int i = 0; i < geom_node->get_num_geoms(); ++i)
+        geom_node->set_geom(i, MeshSimplifier::simplify(geom_node->get_geom(i), ratio, settings.max_error));
+}
+
+NodePath LODGenerator::generate(const NodePath& model, const LODSettings& settings) {
+    PT(LODNode) lod_node = new LODNode(model.get_name() + "-LOD");
+    NodePath lod(lod_node);
+
+    // the model's own transform stays on the lod root, levels are in model space
+    lod.set_transform(model.get_transform());
+    lod.set_state(model.get_state());
+
+    LPoint3 center(0);
+    float radius = 0.0f;
+    LPoint3 min_point, max_point;
+    if (model.calc_tight_bounds(min_point, max_point, model)) {
+        center = (min_point + max_point) * 0.5f;
+        radius = (max_point - min_point).length() * 0.5f;
+    }
+
+    const size_t num_levels = std::min(settings.ratios.size(), settings.screen_sizes.size());
+
+    float near_distance = 0.0f;
+    for (size_t level = 0; level <= num_levels; ++level) {
+        NodePath copy = model.copy_to(lod);
+        copy.clear_transform();
+        copy.clear_state();
+
+        if (level > 0) {
+            const float ratio = settings.ratios[level - 1];
+            if (copy.node()->is_geom_node())
+                simplify_geoms(DCAST(GeomNode, copy.node()), settings, ratio);
+
+            NodePathCollection geom_nodes = copy.find_all_matches("**/+GeomNode");
+            for (int i = 0; i < geom_nodes.get_num_paths(); ++i)
+                simplify_geoms(DCAST(GeomNode, geom_nodes.get_path(i).node()), settings, ratio);
+        }
+
+        // level 'i' is drawn until the model shrinks below screen_sizes[i]
+        float far_distance;
+        if (level < num_levels)
+            far_distance = get_switch_distance(radius, settings.screen_sizes[level], settings.fov);
+        else if (settings.cull_screen_size > 0.0f)
+            far_distance = get_switch_distance(radius, settings.cull_screen_size, settings.fov);
+        else
+            far_distance = 1e30f;
+
+        lod_node->add_switch(far_distance, near_distance);
+        near_distance = far_distance;
+    }
+
+    lod_node->set_center(center);
+    return lod;
+}
+
+void LODGenerator::generate_async(const NodePath& model, const LODSettings& settings, Callback callback) {
+    AsyncTaskManager* task_mgr = AsyncTaskManager::get_global_ptr();
+    AsyncTaskChain* chain = task_mgr->make_task_chain(TASK_CHAIN_NAME);
+    if (chain->get_num_threads() == 0)
+        chain->set_num_threads(1);
+
+    PT(AsyncTask) task = make_task([model, settings, callback](AsyncTask*) -> AsyncTask::DoneStatus {
+        // the worker only reads the source model and builds a detached graph
+        NodePath lod = generate(model, settings);
+
+        // hand the result back to the default chain, which runs on the main thread
+        AsyncTaskManager::get_global_ptr()->add(make_task([lod, callback](AsyncTask*) -> AsyncTask::DoneStatus {
+            callback(lod);
+            return AsyncTask::DS_done;
+        }, "LODGeneratorDone"));
+
+        return AsyncTask::DS_done;
+    }, "LODGeneratorJob");
+
+    task->set_task_chain(TASK_CHAIN_NAME);
+    task_mgr->add(task);
+}
+
+bool LODGenerator::bake(const NodePath& model, const std::string& bam_path, const LODSettings& settings) {
+    return generate(model, settings).write_bam_file(Filename::from_os_specific(bam_path));
+}
+
+float LODGenerator::get_switch_distance(float radius, float screen_size, float fov) {
+    const float half_fov = fov * 0.5f * static_cast<float>(M_PI) / 180.0f;
+    return radius / (screen_size * std::tan(half_fov));
+}
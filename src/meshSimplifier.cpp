@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include <geomTriangles.h>
+#include <geomVertexData.h>
+#include <geomVertexReader.h>
+#include <internalName.h>
+
+#include "meshSimplifier.hpp"
+
+namespace {
+    // symmetric 4x4 error quadric, upper triangle only
+    struct Quadric {
+        double a[10] = { 0 };
+
+        void add_plane(const LVector3d& n, double d, double weight) {
+            a[0] += weight * n[0] * n[0]; a[1] += weight * n[0] * n[1]; a[2] += weight * n[0] * n[2]; a[3] += weight * n[0] * d;
+            a[4] += weight * n[1] * n[1]; a[5] += weight * n[1] * n[2]; a[6] += weight * n[1] * d;
+            a[7] += weight * n[2] * n[2]; a[8] += weight * n[2] * d;
+            a[9] += weight * d * d;
+        }
+
+        Quadric& operator += (const Quadric& other) {
+            for (int i = 0; i < 10; ++i)
+                a[i] += other.a[i];
+            return *this;
+        }
+
+        double evaluate(const LPoint3d& p) const {
+            const double x = p[0], y = p[1], z = p[2];
+            return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x +
+                   a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y +
+                   a[7] * z * z + 2 * a[8] * z +
+                   a[9];
+        }
+    };
+
+    struct Collapse {
+        double   cost;
+        int      from;
+        int      to;
+        unsigned from_version;
+        unsigned to_version;
+
+        bool operator > (const Collapse& other) const { return cost > other.cost; }
+    };
+
+    struct Triangle {
+        int  v[3];
+        bool removed = false;
+
+        bool has(int vertex) const { return v[0] == vertex || v[1] == vertex || v[2] == vertex; }
+    };
+
+    class Simplifier {
+    public:
+        std::vector<LPoint3d>          positions;
+        std::vector<Triangle>          triangles;
+        std::vector<std::vector<int>>  vertex_tris;
+        std::vector<Quadric>           quadrics;
+        std::vector<unsigned>          versions;
+        std::vector<bool>              locked;
+        int                            num_alive = 0;
+
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+
+        void build() {
+            const size_t num_vertices = positions.size();
+            vertex_tris.assign(num_vertices, std::vector<int>());
+            quadrics.assign(num_vertices, Quadric());
+            versions.assign(num_vertices, 0);
+            locked.assign(num_vertices, false);
+
+            std::map<std::pair<int, int>, int> edge_use;
+            for (int t = 0; t < static_cast<int>(triangles.size()); ++t) {
+                const Triangle& tri = triangles[t];
+                LVector3d n = (positions[tri.v[1]] - positions[tri.v[0]]).cross(positions[tri.v[2]] - positions[tri.v[0]]);
+                const double area = n.length();
+                if (area > 0.0)
+                    n /= area;
+
+                const double d = -n.dot(positions[tri.v[0]]);
+                for (int i = 0; i < 3; ++i) {
+                    vertex_tris[tri.v[i]].push_back(t);
+                    quadrics[tri.v[i]].add_plane(n, d, area);
+
+                    int a = tri.v[i], b = tri.v[(i + 1) % 3];
+                    ++edge_use[std::make_pair(std::min(a, b), std::max(a, b))];
+                }
+            }
+            num_alive = static_cast<int>(triangles.size());
+
+            // open edges are mesh borders, keep them in place
+            for (auto& it : edge_use) {
+                if (it.second == 1)
+                    locked[it.first.first] = locked[it.first.second] = true;
+            }
+
+            // vertices sharing a position are attribute seams (uv, normal), collapsing
+            // one side only would tear the mesh
+            std::map<std::tuple<double, double, double>, int> welded;
+            for (int v = 0; v < static_cast<int>(num_vertices); ++v) {
+                if (vertex_tris[v].empty())
+                    continue;
+
+                auto key = std::make_tuple(positions[v][0], positions[v][1], positions[v][2]);
+                auto it = welded.find(key);
+                if (it == welded.end())
+                    welded[key] = v;
+                else
+                    locked[v] = locked[it->second] = true;
+            }
+
+            for (const Triangle& tri : triangles) {
+                for (int i = 0; i < 3; ++i)
+                    push(tri.v[i], tri.v[(i + 1) % 3]);
+            }
+        }
+
+        void push(int from, int to) {
+            if (!locked[from])
+                heap.push({ cost(from, to), from, to, versions[from], versions[to] });
+            if (!locked[to])
+                heap.push({ cost(to, from), to, from, versions[to], versions[from] });
+        }
+
+        double cost(int from, int to) const {
+            Quadric q = quadrics[from];
+            q += quadrics[to];
+            return q.evaluate(positions[to]);
+        }
+
+        void neighbours(int vertex, std::vector<int>& result) const {
+            result.clear();
+            for (int t : vertex_tris[vertex]) {
+                for (int i = 0; i < 3; ++i) {
+                    int w = triangles[t].v[i];
+                    if (w != vertex && std::find(result.begin(), result.end(), w) == result.end())
+                        result.push_back(w);
+                }
+            }
+        }
+
+        bool is_valid(int from, int to) const {
+            // link condition, more than two shared neighbours would make the mesh non-manifold
+            std::vector<int> from_ring, to_ring;
+            neighbours(from, from_ring);
+            neighbours(to, to_ring);
+
+            int shared = 0;
+            for (int w : from_ring) {
+                if (std::find(to_ring.begin(), to_ring.end(), w) != to_ring.end())
+                    ++shared;
+            }
+            if (shared > 2)
+                return false;
+
+            // reject collapses that fold a remaining triangle over
+            for (int t : vertex_tris[from]) {
+                const Triangle& tri = triangles[t];
+                if (tri.has(to))
+                    continue;
+
+                LPoint3d p[3], q[3];
+                for (int i = 0; i < 3; ++i) {
+                    p[i] = positions[tri.v[i]];
+                    q[i] = tri.v[i] == from ? positions[to] : p[i];
+                }
+
+                LVector3d old_n = (p[1] - p[0]).cross(p[2] - p[0]);
+                LVector3d new_n = (q[1] - q[0]).cross(q[2] - q[0]);
+                if (new_n.length_squared() <= 1e-24 || old_n.dot(new_n) < 0.2 * old_n.length() * new_n.length())
+                    return false;
+            }
+
+            return true;
+        }
+
+        void collapse(int from, int to) {
+            for (int t : vertex_tris[from]) {
+                Triangle& tri = triangles[t];
+
+                if (tri.has(to)) {
+                    tri.removed = true;
+                    --num_alive;
+                    for (int i = 0; i < 3; ++i) {
+                        if (tri.v[i] == from)
+                            continue;
+                        std::vector<int>& list = vertex_tris[tri.v[i]];
+                        list.erase(std::remove(list.begin(), list.end(), t), list.end());
+                    }
+                }
+                else {
+                    for (int i = 0; i < 3; ++i) {
+                        if (tri.v[i] == from)
+                            tri.v[i] = to;
+                    }
+                    vertex_tris[to].push_back(t);
+                }
+            }
+
+            vertex_tris[from].clear();
+            quadrics[to] += quadrics[from];
+            ++versions[from];
+            ++versions[to];
+
+            std::vector<int> ring;
+            neighbours(to, ring);
+            for (int w : ring)
+                push(to, w);
+        }
+
+        void run(int target, double max_error) {
+            while (num_alive > target && !heap.empty()) {
+                Collapse c = heap.top();
+                heap.pop();
+
+                if (c.cost > max_error)
+                    break;
+
+                // stale entry, one of the vertices changed since it was queued
+                if (c.from_version != versions[c.from] || c.to_version != versions[c.to] ||
+                    vertex_tris[c.from].empty())
+                    continue;
+
+                if (is_valid(c.from, c.to))
+                    collapse(c.from, c.to);
+            }
+        }
+    };
+}
+
+CPT(Geom) MeshSimplifier::simplify(const Geom* geom, float target_ratio, float max_error) {
+    CPT(Geom) source = geom->decompose();
+    CPT(GeomVertexData) vdata = source->get_vertex_data();
+
+    Simplifier simplifier;
+    simplifier.positions.resize(vdata->get_num_rows());
+
+    GeomVertexReader reader(vdata, InternalName::get_vertex());
+    for (int i = 0; i < vdata->get_num_rows(); ++i)
+        simplifier.positions[i] = LCAST(double, reader.get_data3());
+
+    // collect triangles, other primitive types are passed through unchanged
+    PT(Geom) result = new Geom(vdata);
+    for (size_t p = 0; p < source->get_num_primitives(); ++p) {
+        CPT(GeomPrimitive) prim = source->get_primitive(p);
+        if (prim->get_primitive_type() != GeomPrimitive::PT_polygons) {
+            result->add_primitive(prim);
+            continue;
+        }
+
+        for (int i = 0; i + 2 < prim->get_num_vertices(); i += 3) {
+            Triangle tri;
+            tri.v[0] = prim->get_vertex(i);
+            tri.v[1] = prim->get_vertex(i + 1);
+            tri.v[2] = prim->get_vertex(i + 2);
+            simplifier.triangles.push_back(tri);
+        }
+    }
+
+    if (simplifier.triangles.empty())
+        return geom;
+
+    simplifier.build();
+    simplifier.run(static_cast<int>(simplifier.triangles.size() * target_ratio), max_error);
+
+    PT(GeomTriangles) triangles = new GeomTriangles(GeomEnums::UH_static);
+    if (vdata->get_num_rows() > 0xffff)
+        triangles->set_index_type(GeomEnums::NT_uint32);
+
+    for (const Triangle& tri : simplifier.triangles) {
+        if (!tri.removed)
+            triangles->add_vertices(tri.v[0], tri.v[1], tri.v[2]);
+    }
+
+    result->add_primitive(triangles);
+    return result;
+}
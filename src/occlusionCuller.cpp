@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <asyncTaskManager.h>
+#include <boundingBox.h>
+#include <boundingSphere.h>
+#include <camera.h>
+#include <geomNode.h>
+#include <geomPrimitive.h>
+#include <geomVertexReader.h>
+#include <lens.h>
+#include <nodePathCollection.h>
+
+#include "taskUtils.hpp"
+#include "occlusionCuller.hpp"
+
+static const char* TASK_CHAIN_NAME = "OcclusionCullerChain";
+
+// vertices closer than this (in clip space w) are treated as crossing the near plane
+static const float MIN_W = 1e-4f;
+
+// screen coordinates of vertices near the camera can be huge, clamp before converting
+static int to_pixel(float value, int min_value, int max_value) {
+    return static_cast<int>(std::max(static_cast<float>(min_value), std::min(static_cast<float>(max_value), value)));
+}
+
+OcclusionCuller::OcclusionCuller(const NodePath& camera, const NodePath& root, int width, int height) :
+    camera_(camera),
+    root_(root),
+    width_(std::max(4, width)),
+    height_(std::max(1, height)),
+    enabled_(true),
+    num_threads_(0),
+    num_occluded_(0),
+    task_chain_(nullptr) {
+
+    stride_ = (width_ + 3) & ~3;
+    depth_.assign(static_cast<size_t>(stride_) * height_, 1.0f);
+
+    camera_mask_ = DCAST(Camera, camera_.node())->get_camera_mask();
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    show_all();
+}
+
+void OcclusionCuller::add_occluder(const NodePath& np) {
+    if (np.is_empty())
+        return;
+
+    NodePathCollection geom_nodes = np.find_all_matches("**/+GeomNode");
+    if (np.node()->is_geom_node())
+        geom_nodes.add_path(np);
+
+    for (int n = 0; n < geom_nodes.get_num_paths(); ++n) {
+        NodePath geom_np = geom_nodes.get_path(n);
+        const GeomNode* geom_node = DCAST(GeomNode, geom_np.node());
+        const LMatrix4 mat = geom_np.get_mat(root_);
+
+        for (int g = 0; g < geom_node->get_num_geoms(); ++g) {
+            CPT(Geom) geom = geom_node->get_geom(g)->decompose();
+            CPT(GeomVertexData) vdata = geom->get_vertex_data();
+
+            std::vector<LPoint3> points(vdata->get_num_rows());
+            GeomVertexReader reader(vdata, InternalName::get_vertex());
+            for (size_t i = 0; i < points.size(); ++i)
+                points[i] = mat.xform_point(reader.get_data3());
+
+            for (size_t p = 0; p < geom->get_num_primitives(); ++p) {
+                CPT(GeomPrimitive) prim = geom->get_primitive(p);
+                if (prim->get_primitive_type() != GeomPrimitive::PT_polygons)
+                    continue;
+
+                for (int i = 0; i + 2 < prim->get_num_vertices(); i += 3) {
+                    occluder_points_.push_back(points[prim->get_vertex(i)]);
+                    occluder_points_.push_back(points[prim->get_vertex(i + 1)]);
+                    occluder_points_.push_back(points[prim->get_vertex(i + 2)]);
+                }
+            }
+        }
+    }
+
+    screen_triangles_.resize(occluder_points_.size() / 3);
+}
+
+void OcclusionCuller::add_occludee(const NodePath& np) {
+    if (np.is_empty())
+        return;
+
+    Occludee occludee;
+    occludee.np = np;
+    occludees_.push_back(occludee);
+}
+
+void OcclusionCuller::remove_occludee(const NodePath& np) {
+    auto it = std::find_if(occludees_.begin(), occludees_.end(), [&np](const Occludee& o) { return o.np == np; });
+    if (it == occludees_.end())
+        return;
+
+    if (it->hidden && !it->np.is_empty())
+        it->np.show(camera_mask_);
+
+    *it = occludees_.back();
+    occludees_.pop_back();
+}
+
+void OcclusionCuller::clear() {
+    show_all();
+    occludees_.clear();
+    occluder_points_.clear();
+    screen_triangles_.clear();
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+}
+
+void OcclusionCuller::set_enabled(bool enabled) {
+    enabled_ = enabled;
+    if (!enabled_)
+        show_all();
+}
+
+void OcclusionCuller::set_num_threads(int num_threads) {
+    num_threads_ = std::max(0, num_threads);
+    if (num_threads_ == 0)
+        return;
+
+    task_chain_ = AsyncTaskManager::get_global_ptr()->make_task_chain(TASK_CHAIN_NAME);
+    if (task_chain_->get_num_threads() < num_threads_)
+        task_chain_->set_num_threads(num_threads_);
+}
+
+void OcclusionCuller::update() {
+    if (!enabled_ || camera_.is_empty())
+        return;
+
+    const Lens* lens = DCAST(Camera, camera_.node())->get_lens();
+    if (!lens)
+        return;
+
+    // row vectors, root space -> camera space -> clip space
+    view_proj_ = root_.get_mat(camera_) * lens->get_projection_mat();
+
+    // bounds read the scene graph, keep that on this thread
+    for (Occludee& occludee : occludees_)
+        update_bounds(occludee);
+
+    std::fill(depth_.begin(), depth_.end(), 1.0f);
+
+    run_jobs(screen_triangles_.size(), [this](size_t begin, size_t end) { project_triangles(begin, end); });
+    run_jobs(static_cast<size_t>(height_), [this](size_t begin, size_t end) {
+        rasterize_band(static_cast<int>(begin), static_cast<int>(end));
+    });
+    run_jobs(occludees_.size(), [this](size_t begin, size_t end) { test_occludees(begin, end); });
+
+    // draw masks are set here, workers only wrote 'visible'
+    num_occluded_ = 0;
+    for (Occludee& occludee : occludees_) {
+        if (occludee.np.is_empty())
+            continue;
+
+        if (!occludee.visible) {
+            ++num_occluded_;
+            if (!occludee.hidden) {
+                occludee.np.hide(camera_mask_);
+                occludee.hidden = true;
+            }
+        }
+        else if (occludee.hidden) {
+            occludee.np.show(camera_mask_);
+            occludee.hidden = false;
+        }
+    }
+}
+
+void OcclusionCuller::update_bounds(Occludee& occludee) {
+    if (occludee.np.is_empty()) {
+        occludee.has_bounds = false;
+        return;
+    }
+
+    // transform states are unique, an unmoved occludee keeps the same pointer
+    CPT(TransformState) transform = occludee.np.get_transform(root_);
+    if (transform == occludee.last_transform && occludee.has_bounds)
+        return;
+    occludee.last_transform = transform;
+
+    CPT(BoundingVolume) bounds = occludee.np.get_bounds();
+    const GeometricBoundingVolume* gbv = bounds->as_geometric_bounding_volume();
+    if (!gbv || bounds->is_empty() || bounds->is_infinite()) {
+        occludee.has_bounds = false;
+        return;
+    }
+
+    PT(GeometricBoundingVolume) world = DCAST(GeometricBoundingVolume, gbv->make_copy());
+    world->xform(transform->get_mat());
+
+    if (world->is_of_type(BoundingBox::get_class_type())) {
+        const BoundingBox* box = DCAST(BoundingBox, world);
+        occludee.min_point = box->get_minq();
+        occludee.max_point = box->get_maxq();
+    }
+    else {
+        BoundingSphere sphere;
+        sphere.extend_by(world);
+        const LVector3 extent(sphere.get_radius());
+        occludee.min_point = sphere.get_center() - extent;
+        occludee.max_point = sphere.get_center() + extent;
+    }
+
+    occludee.has_bounds = true;
+}
+
+void OcclusionCuller::project_triangles(size_t begin, size_t end) {
+    const float half_w = width_ * 0.5f;
+    const float half_h = height_ * 0.5f;
+
+    for (size_t t = begin; t < end; ++t) {
+        ScreenTriangle& tri = screen_triangles_[t];
+        tri.valid = true;
+
+        for (int i = 0; i < 3; ++i) {
+            const LVecBase4 clip = view_proj_.xform(LVecBase4(occluder_points_[t * 3 + i], 1.0f));
+
+            // occluders crossing the near plane are dropped rather than clipped, missing an
+            // occluder only makes the result less tight, never wrong
+            if (clip[3] < MIN_W) {
+                tri.valid = false;
+                break;
+            }
+
+            const float inv_w = 1.0f / clip[3];
+            tri.x[i] = (clip[0] * inv_w + 1.0f) * half_w;
+            tri.y[i] = (clip[1] * inv_w + 1.0f) * half_h;
+            tri.z[i] = clip[2] * inv_w * 0.5f + 0.5f;
+        }
+    }
+}
+
+void OcclusionCuller::rasterize_band(int y_begin, int y_end) {
+    for (const ScreenTriangle& tri : screen_triangles_) {
+        if (!tri.valid)
+            continue;
+
+        int v1 = 1, v2 = 2;
+        float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.y[1] - tri.y[0]) * (tri.x[2] - tri.x[0]);
+        if (std::fabs(area) < 1e-6f)
+            continue;
+
+        // both faces are drawn, flip the winding so inside is always positive
+        if (area < 0.0f) {
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        const float x0 = tri.x[0], y0 = tri.y[0], z0 = tri.z[0];
+        const float x1 = tri.x[v1], y1 = tri.y[v1], z1 = tri.z[v1];
+        const float x2 = tri.x[v2], y2 = tri.y[v2], z2 = tri.z[v2];
+
+        // skip triangles entirely behind the far plane
+        if (z0 > 1.0f && z1 > 1.0f && z2 > 1.0f)
+            continue;
+
+        const float left = std::min({ x0, x1, x2 }), right = std::max({ x0, x1, x2 });
+        const float bottom = std::min({ y0, y1, y2 }), top = std::max({ y0, y1, y2 });
+        if (right < 0.0f || left > width_ || top < y_begin || bottom > y_end)
+            continue;
+
+        const int min_x = to_pixel(std::floor(left), 0, width_ - 1);
+        const int max_x = to_pixel(std::ceil(right), 0, width_ - 1);
+        const int min_y = to_pixel(std::floor(bottom), y_begin, y_end - 1);
+        const int max_y = to_pixel(std::ceil(top), y_begin, y_end - 1);
+
+        // edge functions e(x, y) = a * x + b * y + c, positive inside
+        const float a0 = y1 - y2, b0 = x2 - x1, c0 = x1 * y2 - x2 * y1;  // opposite v0
+        const float a1 = y2 - y0, b1 = x0 - x2, c1 = x2 * y0 - x0 * y2;  // opposite v1
+        const float a2 = y0 - y1, b2 = x1 - x0, c2 = x0 * y1 - x1 * y0;  // opposite v2
+
+        // depth is affine in screen space, z = za * x + zb * y + zc
+        const float inv_area = 1.0f / area;
+        const float za = (a0 * z0 + a1 * z1 + a2 * z2) * inv_area;
+        const float zb = (b0 * z0 + b1 * z1 + b2 * z2) * inv_area;
+        const float zc = (c0 * z0 + c1 * z1 + c2 * z2) * inv_area;
+
+        // spans start on a 4 float boundary, the padding columns are never tested
+        const int start_x = min_x & ~3;
+
+        for (int y = min_y; y <= max_y; ++y) {
+            const float py = y + 0.5f;
+            float* row = &depth_[static_cast<size_t>(y) * stride_];
+
+#ifdef OCCLUSION_CULLER_SSE2
+            const __m128 step_x = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            const __m128 zero = _mm_setzero_ps();
+
+            __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(start_x)), step_x);
+            const __m128 four = _mm_set1_ps(4.0f);
+
+            for (int x = start_x; x <= max_x; x += 4) {
+                const __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+                const __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+                const __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+
+                const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                                 _mm_cmpge_ps(e2, zero));
+
+                if (_mm_movemask_ps(inside) != 0) {
+                    const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+                    const __m128 old_z = _mm_loadu_ps(row + x);
+                    const __m128 new_z = _mm_min_ps(old_z, z);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_z), _mm_andnot_ps(inside, old_z)));
+                }
+
+                px = _mm_add_ps(px, four);
+            }
+#else
+            for (int x = start_x; x <= max_x; ++x) {
+                const float px = x + 0.5f;
+                if (a0 * px + b0 * py + c0 < 0.0f ||
+                    a1 * px + b1 * py + c1 < 0.0f ||
+                    a2 * px + b2 * py + c2 < 0.0f)
+                    continue;
+
+                const float z = za * px + zb * py + zc;
+                if (z < row[x])
+                    row[x] = z;
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::test_occludees(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+        occludees_[i].visible = !is_occluded(occludees_[i]);
+}
+
+bool OcclusionCuller::is_occluded(const Occludee& occludee) const {
+    if (!occludee.has_bounds)
+        return false;
+
+    float min_sx = 1e30f, min_sy = 1e30f, max_sx = -1e30f, max_sy = -1e30f;
+    float nearest = 1e30f;
+
+    for (int corner = 0; corner < 8; ++corner) {
+        const LPoint3 p((corner & 1) ? occludee.max_point[0] : occludee.min_point[0],
+                        (corner & 2) ? occludee.max_point[1] : occludee.min_point[1],
+                        (corner & 4) ? occludee.max_point[2] : occludee.min_point[2]);
+
+        const LVecBase4 clip = view_proj_.xform(LVecBase4(p, 1.0f));
+
+        // the box reaches behind the camera, treat it as visible
+        if (clip[3] < MIN_W)
+            return false;
+
+        const float inv_w = 1.0f / clip[3];
+        const float sx = (clip[0] * inv_w + 1.0f) * width_ * 0.5f;
+        const float sy = (clip[1] * inv_w + 1.0f) * height_ * 0.5f;
+
+        min_sx = std::min(min_sx, sx);
+        max_sx = std::max(max_sx, sx);
+        min_sy = std::min(min_sy, sy);
+        max_sy = std::max(max_sy, sy);
+        nearest = std::min(nearest, clip[2] * inv_w * 0.5f + 0.5f);
+    }
+
+    // off screen, that is left to frustum culling
+    if (max_sx < 0.0f || min_sx > width_ || max_sy < 0.0f || min_sy > height_)
+        return false;
+
+    const int x0 = to_pixel(std::floor(min_sx), 0, width_ - 1);
+    const int x1 = to_pixel(std::ceil(max_sx), 0, width_ - 1);
+    const int y0 = to_pixel(std::floor(min_sy), 0, height_ - 1);
+    const int y1 = to_pixel(std::ceil(max_sy), 0, height_ - 1);
+
+    // occluded only if every covered pixel has an occluder strictly in front of the box
+    for (int y = y0; y <= y1; ++y) {
+        const float* row = &depth_[static_cast<size_t>(y) * stride_];
+        int x = x0;
+
+#ifdef OCCLUSION_CULLER_SSE2
+        const __m128 box_z = _mm_set1_ps(nearest);
+        for (; x + 3 <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), box_z)) != 0)
+                return false;
+        }
+#endif
+        for (; x <= x1; ++x) {
+            if (row[x] >= nearest)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+template<class Job>
+void OcclusionCuller::run_jobs(size_t count, Job job) {
+    if (count == 0)
+        return;
+
+    if (num_threads_ == 0 || count < static_cast<size_t>(num_threads_) * 2) {
+        job(0, count);
+        return;
+    }
+
+    const size_t num_jobs = static_cast<size_t>(num_threads_);
+    const size_t job_size = (count + num_jobs - 1) / num_jobs;
+
+    AsyncTaskManager* task_mgr = AsyncTaskManager::get_global_ptr();
+    for (size_t begin = 0; begin < count; begin += job_size) {
+        const size_t end = std::min(begin + job_size, count);
+
+        // every job works on a disjoint range, bands never share depth rows
+        PT(AsyncTask) task = make_task([job, begin, end](AsyncTask*) -> AsyncTask::DoneStatus {
+            job(begin, end);
+            return AsyncTask::DS_done;
+        }, "OcclusionCullerJob");
+        task->set_task_chain(TASK_CHAIN_NAME);
+        task_mgr->add(task);
+    }
+
+    task_chain_->wait_for_tasks();
+}
+
+void OcclusionCuller::show_all() {
+    for (Occludee& occludee : occludees_) {
+        if (occludee.hidden && !occludee.np.is_empty())
+            occludee.np.show(camera_mask_);
+        occludee.hidden = false;
+        occludee.visible = true;
+    }
+    num_occluded_ = 0;
+}
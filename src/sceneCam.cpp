@@ -4,13 +4,17 @@
 #include <camera.h>
 #include <perspectiveLens.h>
 #include <lineSegs.h>
-#include <clockObject.h>
+#include <mouseButton.h>
 
 #include "constants.hpp"
 #include "mathUtils.hpp"
 #include "engine.hpp"
 #include "sceneCam.hpp"
 
+// mouse deltas already cover the whole frame, scaling them by the frame time as well made
+// the camera jump further the slower the frame, 'move_speed' was tuned at 60 fps
+static const float REFERENCE_DT = 1.0f / 60.0f;
+
 SceneCam::SceneCam(Engine& engine, float move_speed, const LVecBase3f& default_pos)
     : engine(engine), move_speed(move_speed), default_pos(default_pos), delta_speed(0.0f) {
 
@@ -64,18 +68,18 @@ void SceneCam::move(const LVecBase3f& move_vec) {
     LVecBase3f camera_vec = get_pos() - target.get_pos();
     LVecBase3f modified_move_vec = move_vec * (camera_vec.length() / 300.0f);
 
-    set_pos(*this, modified_move_vec);
-    target.set_quat(get_quat());
+    // one transform per node, moves are expressed in the camera's own frame
+    LQuaternion quat = get_quat();
+    set_pos(get_pos() + quat.xform(modified_move_vec));
 
     LVecBase3f target_move_vec(modified_move_vec.get_x(), 0, modified_move_vec.get_z());
-    target.set_pos(target, target_move_vec);
+    target.set_pos_quat(target.get_pos() + quat.xform(target_move_vec), quat);
 }
 
 void SceneCam::orbit(const LVecBase2f& delta) {
     LVecBase3f hpr = get_hpr();
     hpr.set_x(hpr.get_x() + delta.get_x());
     hpr.set_y(hpr.get_y() + delta.get_y());
-    set_hpr(hpr);
 
     float rad_x = hpr.get_x() * (M_PI / 180.0f);
     float rad_y = hpr.get_y() * (M_PI / 180.0f);
@@ -89,20 +93,20 @@ void SceneCam::orbit(const LVecBase2f& delta) {
         -cam_vec_dist * sin(rad_y)
     );
 
-    set_pos(new_pos);
+    set_pos_hpr(new_pos, hpr);
 }
 
 void SceneCam::update() {
     if (!engine.mouse.has_mouse() || !engine.mouse.has_modifier(ALT_KEY_IDX))
         return;
 
-    delta_speed = move_speed * ClockObject::get_global_clock()->get_dt();
+    delta_speed = move_speed * REFERENCE_DT;
 
-    if (engine.mouse.is_button_down("mouse1")) {
+    if (engine.mouse.is_button_down(MouseButton::one())) {
         orbit(LVecBase2f(engine.mouse.get_dx() * delta_speed, engine.mouse.get_dy() * delta_speed));
-    } else if (engine.mouse.is_button_down("mouse2")) {
+    } else if (engine.mouse.is_button_down(MouseButton::two())) {
         move(LVecBase3f(engine.mouse.get_dx() * delta_speed, 0, -engine.mouse.get_dy() * delta_speed));
-    } else if (engine.mouse.is_button_down("mouse3")) {
+    } else if (engine.mouse.is_button_down(MouseButton::three())) {
         move(LVecBase3f(0, -engine.mouse.get_dx() * delta_speed, 0));
     }
 
@@ -110,10 +114,13 @@ void SceneCam::update() {
 }
 
 void SceneCam::update_axes() {
-    axes.set_pos(engine.get_aspect_ratio() - 0.25f, 0.0f, 1.0f - 0.25f);
     LQuaternion camera_quat(get_quat());
     camera_quat.invert_in_place();
-    axes.set_quat(camera_quat);
+    axes.set_pos_quat(LPoint3(engine.get_aspect_ratio() - 0.25f, 0.0f, 1.0f - 0.25f), camera_quat);
+}
+
+float SceneCam::get_target_distance() const {
+    return (get_pos() - target.get_pos()).length();
 }
 
 void SceneCam::reset() {
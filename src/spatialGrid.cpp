@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cmath>
+
+#include <boundingBox.h>
+#include <boundingSphere.h>
+#include <geometricBoundingVolume.h>
+#include <nodePathCollection.h>
+
+#include "spatialGrid.hpp"
+
+// 21 bits per axis, cells are offset so negative coordinates pack too
+static const int64_t KEY_BITS   = 21;
+static const int64_t KEY_MASK   = (int64_t(1) << KEY_BITS) - 1;
+static const int64_t KEY_OFFSET = int64_t(1) << (KEY_BITS - 1);
+
+static int floor_div(int value, int divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+SpatialGrid::SpatialGrid(const NodePath& root, float cell_size, float looseness) :
+    root_(root),
+    cell_size_(cell_size),
+    looseness_(looseness),
+    num_moved_(0) {
+
+    large_ = root_.attach_new_node("large");
+}
+
+void SpatialGrid::organize() {
+    NodePathCollection children = root_.get_children();
+    for (int i = 0; i < children.get_num_paths(); ++i) {
+        NodePath np = children.get_path(i);
+        if (np == large_ || np.get_name().compare(0, 7, "region_") == 0)
+            continue;
+
+        add(np, np.has_tag("dynamic"));
+    }
+}
+
+void SpatialGrid::add(NodePath np, bool dynamic) {
+    if (np.is_empty())
+        return;
+
+    Object object;
+    object.np = np;
+    object.dynamic = dynamic;
+    object.last_transform = np.get_transform(root_);
+    place(object);
+    objects_.push_back(object);
+}
+
+void SpatialGrid::remove(NodePath np) {
+    auto it = std::find_if(objects_.begin(), objects_.end(), [&np](const Object& o) { return o.np == np; });
+    if (it == objects_.end())
+        return;
+
+    leave_cell(*it);
+    it->np.reparent_to(root_);
+
+    *it = objects_.back();
+    objects_.pop_back();
+}
+
+void SpatialGrid::update() {
+    num_moved_ = 0;
+
+    for (Object& object : objects_) {
+        if (!object.dynamic || object.np.is_empty())
+            continue;
+
+        // transform states are unique, a node that did not move keeps the same pointer
+        CPT(TransformState) transform = object.np.get_transform(root_);
+        if (transform == object.last_transform)
+            continue;
+        object.last_transform = transform;
+
+        LPoint3 center;
+        PN_stdfloat radius;
+        if (!calc_world_sphere(object.np, center, radius))
+            continue;
+
+        const bool large = radius > cell_size_ * looseness_;
+        if (large == object.large && (large || is_inside_loose_cell(object.cell, center)))
+            continue;
+
+        leave_cell(object);
+        place(object);
+        ++num_moved_;
+    }
+}
+
+void SpatialGrid::clear() {
+    for (Object& object : objects_)
+        object.np.reparent_to(root_);
+
+    for (auto& it : regions_)
+        it.second.np.remove_node();
+
+    objects_.clear();
+    cells_.clear();
+    regions_.clear();
+}
+
+int64_t SpatialGrid::pack_key(int x, int y, int z) {
+    return (((int64_t(x) + KEY_OFFSET) & KEY_MASK) << (KEY_BITS * 2)) |
+           (((int64_t(y) + KEY_OFFSET) & KEY_MASK) << KEY_BITS) |
+           ((int64_t(z) + KEY_OFFSET) & KEY_MASK);
+}
+
+void SpatialGrid::unpack_key(int64_t key, int& x, int& y, int& z) {
+    x = static_cast<int>(((key >> (KEY_BITS * 2)) & KEY_MASK) - KEY_OFFSET);
+    y = static_cast<int>(((key >> KEY_BITS) & KEY_MASK) - KEY_OFFSET);
+    z = static_cast<int>((key & KEY_MASK) - KEY_OFFSET);
+}
+
+bool SpatialGrid::calc_world_sphere(const NodePath& np, LPoint3& center, PN_stdfloat& radius) const {
+    // bounds are in the node's own space, bring them into root space
+    CPT(BoundingVolume) bounds = np.get_bounds();
+    const GeometricBoundingVolume* gbv = bounds->as_geometric_bounding_volume();
+    if (!gbv || bounds->is_empty() || bounds->is_infinite()) {
+        center = np.get_pos(root_);
+        radius = 0;
+        return !bounds->is_infinite();
+    }
+
+    PT(GeometricBoundingVolume) world = DCAST(GeometricBoundingVolume, gbv->make_copy());
+    world->xform(np.get_mat(root_));
+
+    center = world->get_approx_center();
+    radius = 0;
+
+    if (world->is_of_type(BoundingSphere::get_class_type())) {
+        radius = DCAST(BoundingSphere, world)->get_radius();
+    }
+    else if (world->is_of_type(BoundingBox::get_class_type())) {
+        const BoundingBox* box = DCAST(BoundingBox, world);
+        radius = (box->get_maxq() - box->get_minq()).length() * 0.5f;
+    }
+    else {
+        // other volumes, fall back to a sphere around the object
+        BoundingSphere sphere;
+        sphere.extend_by(world);
+        radius = sphere.get_radius();
+    }
+
+    return true;
+}
+
+int64_t SpatialGrid::get_cell_key(const LPoint3& center) const {
+    return pack_key(
+        static_cast<int>(std::floor(center[0] / cell_size_)),
+        static_cast<int>(std::floor(center[1] / cell_size_)),
+        static_cast<int>(std::floor(center[2] / cell_size_)));
+}
+
+bool SpatialGrid::is_inside_loose_cell(int64_t cell, const LPoint3& center) const {
+    int x, y, z;
+    unpack_key(cell, x, y, z);
+
+    const PN_stdfloat margin = cell_size_ * looseness_;
+    const LPoint3 min_point(x * cell_size_ - margin, y * cell_size_ - margin, z * cell_size_ - margin);
+    const LPoint3 max_point((x + 1) * cell_size_ + margin, (y + 1) * cell_size_ + margin, (z + 1) * cell_size_ + margin);
+
+    return center[0] >= min_point[0] && center[0] <= max_point[0] &&
+           center[1] >= min_point[1] && center[1] <= max_point[1] &&
+           center[2] >= min_point[2] && center[2] <= max_point[2];
+}
+
+void SpatialGrid::place(Object& object) {
+    LPoint3 center;
+    PN_stdfloat radius;
+    if (!calc_world_sphere(object.np, center, radius) || radius > cell_size_ * looseness_) {
+        // too big (or unbounded) to fit a loose cell
+        object.large = true;
+        object.np.reparent_to(large_);
+        return;
+    }
+
+    object.large = false;
+    object.cell = get_cell_key(center);
+    object.np.reparent_to(get_cell(object.cell));
+    ++cells_[object.cell].count;
+}
+
+void SpatialGrid::leave_cell(Object& object) {
+    if (object.large)
+        return;
+
+    auto it = cells_.find(object.cell);
+    if (it == cells_.end() || --it->second.count > 0)
+        return;
+
+    // drop empty cells and regions so the culler doesn't visit them
+    Region& region = regions_[it->second.region];
+    const int64_t region_key = it->second.region;
+
+    // the object is still under the cell here, move it out before removing the cell
+    object.np.reparent_to(root_);
+    it->second.np.remove_node();
+    cells_.erase(it);
+
+    if (--region.count == 0) {
+        region.np.remove_node();
+        regions_.erase(region_key);
+    }
+}
+
+NodePath SpatialGrid::get_cell(int64_t key) {
+    auto it = cells_.find(key);
+    if (it != cells_.end())
+        return it->second.np;
+
+    int x, y, z;
+    unpack_key(key, x, y, z);
+
+    const int rx = floor_div(x, REGION_CELLS);
+    const int ry = floor_div(y, REGION_CELLS);
+    const int rz = floor_div(z, REGION_CELLS);
+    const int64_t region_key = pack_key(rx, ry, rz);
+
+    Region& region = regions_[region_key];
+    if (region.np.is_empty()) {
+        region.np = root_.attach_new_node(
+            "region_" + std::to_string(rx) + "_" + std::to_string(ry) + "_" + std::to_string(rz));
+    }
+    ++region.count;
+
+    Cell& cell = cells_[key];
+    cell.region = region_key;
+    cell.np = region.np.attach_new_node(
+        "cell_" + std::to_string(x) + "_" + std::to_string(y) + "_" + std::to_string(z));
+
+    return cell.np;
+}
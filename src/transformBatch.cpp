@@ -0,0 +1,123 @@
+#include <algorithm>
+
+#include <asyncTaskManager.h>
+#include <pandaNode.h>
+#include <thread.h>
+
+#include "taskUtils.hpp"
+#include "transformBatch.hpp"
+
+// all batches share one worker chain, it is created on first use
+static const char* TASK_CHAIN_NAME = "TransformBatchChain";
+
+TransformBatch::TransformBatch() : num_threads_(0), task_chain_(nullptr) {}
+
+TransformBatch::~TransformBatch() {}
+
+size_t TransformBatch::add(const NodePath& np) {
+    nodes_.push_back(np);
+    positions.push_back(np.get_pos());
+    quats.push_back(np.get_quat());
+    scales.push_back(np.get_scale());
+    return nodes_.size() - 1;
+}
+
+size_t TransformBatch::add(const NodePath& np, const LPoint3& pos, const LQuaternion& quat, const LVecBase3& scale) {
+    nodes_.push_back(np);
+    positions.push_back(pos);
+    quats.push_back(quat);
+    scales.push_back(scale);
+    return nodes_.size() - 1;
+}
+
+void TransformBatch::clear() {
+    nodes_.clear();
+    states_.clear();
+    positions.clear();
+    quats.clear();
+    scales.clear();
+}
+
+void TransformBatch::reserve(size_t count) {
+    nodes_.reserve(count);
+    states_.reserve(count);
+    positions.reserve(count);
+    quats.reserve(count);
+    scales.reserve(count);
+}
+
+void TransformBatch::set(size_t i, const LPoint3& pos, const LQuaternion& quat) {
+    positions[i] = pos;
+    quats[i] = quat;
+}
+
+void TransformBatch::set(size_t i, const LPoint3& pos, const LQuaternion& quat, const LVecBase3& scale) {
+    positions[i] = pos;
+    quats[i] = quat;
+    scales[i] = scale;
+}
+
+void TransformBatch::read() {
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        CPT(TransformState) state = nodes_[i].node()->get_transform();
+        positions[i] = state->get_pos();
+        quats[i] = state->get_quat();
+        scales[i] = state->get_scale();
+    }
+}
+
+void TransformBatch::commit() {
+    const size_t count = nodes_.size();
+    states_.resize(count);
+
+    if (num_threads_ > 0 && count >= static_cast<size_t>(num_threads_) * 2)
+        build_states_parallel();
+    else
+        build_states(0, count);
+
+    // scene graph writes stay on the calling thread
+    Thread* current_thread = Thread::get_current_thread();
+    for (size_t i = 0; i < count; ++i) {
+        PandaNode* node = nodes_[i].node();
+
+        // states are unique through the cache, an unchanged transform is the same pointer
+        if (node->get_transform(current_thread) != states_[i])
+            node->set_transform(states_[i], current_thread);
+    }
+}
+
+void TransformBatch::set_num_threads(int num_threads) {
+    num_threads_ = std::max(0, num_threads);
+    if (num_threads_ == 0)
+        return;
+
+    task_chain_ = AsyncTaskManager::get_global_ptr()->make_task_chain(TASK_CHAIN_NAME);
+    if (task_chain_->get_num_threads() < num_threads_)
+        task_chain_->set_num_threads(num_threads_);
+}
+
+void TransformBatch::build_states(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i)
+        states_[i] = TransformState::make_pos_quat_scale(positions[i], quats[i], scales[i]);
+}
+
+void TransformBatch::build_states_parallel() {
+    const size_t count = nodes_.size();
+    const size_t num_jobs = static_cast<size_t>(num_threads_);
+    const size_t job_size = (count + num_jobs - 1) / num_jobs;
+
+    AsyncTaskManager* task_mgr = AsyncTaskManager::get_global_ptr();
+    for (size_t begin = 0; begin < count; begin += job_size) {
+        const size_t end = std::min(begin + job_size, count);
+
+        // every job writes a disjoint range of 'states_', the state cache itself is locked
+        PT(AsyncTask) task = make_task([this, begin, end](AsyncTask*) -> AsyncTask::DoneStatus {
+            build_states(begin, end);
+            return AsyncTask::DS_done;
+        }, "TransformBatchJob");
+        task->set_task_chain(TASK_CHAIN_NAME);
+        task_mgr->add(task);
+    }
+
+    task_chain_->wait_for_tasks();
+}
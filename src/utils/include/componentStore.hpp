@@ -0,0 +1,241 @@
+#ifndef COMPONENT_STORE_H
+#define COMPONENT_STORE_H
+
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <nodePath.h>
+#include <pandaNode.h>
+#include <transformState.h>
+#include <lpoint3.h>
+#include <lvector3.h>
+
+#include "transformBatch.hpp"
+
+// Entity handle, the low 20 bits are a slot index and the high 12 bits a generation
+// which is bumped whenever the slot is recycled, so stale handles fail 'is_alive'.
+typedef uint32_t Entity;
+
+static constexpr Entity INVALID_ENTITY = 0xFFFFFFFFu;
+
+// Common components
+struct Transform {
+    LPoint3   pos;
+    LVecBase3 hpr;
+    LVecBase3 scale = LVecBase3(1.0f);
+};
+
+struct Velocity {
+    LVector3  linear;   // units per second, in parent space
+    LVecBase3 angular;  // degrees per second
+};
+
+// An archetype: every entity in the store has all 'Components', each component type is kept
+// in its own contiguous array (SoA) so systems stream through memory instead of chasing
+// 'NodePath's. Removal swaps the last entity into the hole so arrays never have gaps.
+template <typename... Components>
+class ComponentStore {
+public:
+    // 'np' is the node the entity's 'Transform' is written to by 'write_transforms', may be empty
+    Entity create(const NodePath& np, const Components&... components) {
+        uint32_t slot;
+        if (!free_slots_.empty()) {
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+        }
+        else {
+            slot = static_cast<uint32_t>(slot_to_row_.size());
+            slot_to_row_.push_back(0);
+            generations_.push_back(0);
+        }
+
+        slot_to_row_[slot] = static_cast<uint32_t>(entities_.size());
+
+        Entity entity = make_entity(slot, generations_[slot]);
+        entities_.push_back(entity);
+        nodes_.push_back(np);
+        push_components(std::index_sequence_for<Components...>(), components...);
+        return entity;
+    }
+
+    void destroy(Entity entity) {
+        if (!is_alive(entity))
+            return;
+
+        const uint32_t slot = slot_of(entity);
+        const uint32_t row  = slot_to_row_[slot];
+        const uint32_t last = static_cast<uint32_t>(entities_.size() - 1);
+
+        if (row != last) {
+            entities_[row] = entities_[last];
+            nodes_[row]    = nodes_[last];
+            move_row(std::index_sequence_for<Components...>(), last, row);
+            slot_to_row_[slot_of(entities_[row])] = row;
+        }
+
+        entities_.pop_back();
+        nodes_.pop_back();
+        pop_row(std::index_sequence_for<Components...>());
+
+        generations_[slot] = (generations_[slot] + 1) & GENERATION_MASK;
+        free_slots_.push_back(slot);
+    }
+
+    bool is_alive(Entity entity) const {
+        const uint32_t slot = slot_of(entity);
+        return entity != INVALID_ENTITY &&
+               slot < generations_.size() &&
+               generations_[slot] == generation_of(entity) &&
+               slot_to_row_[slot] < entities_.size() &&
+               entities_[slot_to_row_[slot]] == entity;
+    }
+
+    void clear() {
+        for (Entity entity : entities_) {
+            const uint32_t slot = slot_of(entity);
+            generations_[slot] = (generations_[slot] + 1) & GENERATION_MASK;
+            free_slots_.push_back(slot);
+        }
+
+        entities_.clear();
+        nodes_.clear();
+        clear_rows(std::index_sequence_for<Components...>());
+    }
+
+    void reserve(size_t count) {
+        entities_.reserve(count);
+        nodes_.reserve(count);
+        reserve_rows(std::index_sequence_for<Components...>(), count);
+    }
+
+    size_t size() const { return entities_.size(); }
+
+    // Component access, only valid while no entity is created or destroyed
+    template <typename C>
+    C& get(Entity entity) { return column<C>()[slot_to_row_[slot_of(entity)]]; }
+
+    template <typename C>
+    std::vector<C>& column() { return std::get<std::vector<C>>(columns_); }
+
+    template <typename C>
+    const std::vector<C>& column() const { return std::get<std::vector<C>>(columns_); }
+
+    const std::vector<Entity>&   entities() const { return entities_; }
+    const std::vector<NodePath>& nodes() const { return nodes_; }
+
+    // Calls 'fn(Selected&...)' for every entity, e.g.
+    // store.for_each<Transform, Velocity>([dt](Transform& t, Velocity& v) { t.pos += v.linear * dt; });
+    template <typename... Selected, typename Fn>
+    void for_each(Fn fn) {
+        for_each_row(fn, entities_.size(), column<Selected>().data()...);
+    }
+
+private:
+    static constexpr uint32_t INDEX_BITS      = 20;
+    static constexpr uint32_t INDEX_MASK      = (1u << INDEX_BITS) - 1;
+    static constexpr uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+
+    std::tuple<std::vector<Components>...> columns_;
+    std::vector<Entity>   entities_;     // row -> entity
+    std::vector<NodePath> nodes_;        // row -> node
+    std::vector<uint32_t> slot_to_row_;
+    std::vector<uint32_t> generations_;
+    std::vector<uint32_t> free_slots_;
+
+    static Entity   make_entity(uint32_t slot, uint32_t generation) { return (generation << INDEX_BITS) | slot; }
+    static uint32_t slot_of(Entity entity) { return entity & INDEX_MASK; }
+    static uint32_t generation_of(Entity entity) { return entity >> INDEX_BITS; }
+
+    template <typename Fn, typename... Ptrs>
+    static void for_each_row(Fn& fn, size_t count, Ptrs... ptrs) {
+        for (size_t i = 0; i < count; ++i)
+            fn(ptrs[i]...);
+    }
+
+    // the 'expand' arrays below are the C++14 stand-in for fold expressions
+    template <size_t... I>
+    void push_components(std::index_sequence<I...>, const Components&... components) {
+        int expand[] = { 0, (std::get<I>(columns_).push_back(components), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void move_row(std::index_sequence<I...>, uint32_t from, uint32_t to) {
+        int expand[] = { 0, (std::get<I>(columns_)[to] = std::move(std::get<I>(columns_)[from]), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void pop_row(std::index_sequence<I...>) {
+        int expand[] = { 0, (std::get<I>(columns_).pop_back(), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void clear_rows(std::index_sequence<I...>) {
+        int expand[] = { 0, (std::get<I>(columns_).clear(), 0)... };
+        (void)expand;
+    }
+
+    template <size_t... I>
+    void reserve_rows(std::index_sequence<I...>, size_t count) {
+        int expand[] = { 0, (std::get<I>(columns_).reserve(count), 0)... };
+        (void)expand;
+    }
+};
+
+// ----------------------------------------- systems ----------------------------------------- //
+// Advances every 'Transform' by its 'Velocity'.
+template <typename Store>
+void integrate_velocities(Store& store, float dt) {
+    store.template for_each<Transform, Velocity>([dt](Transform& transform, const Velocity& velocity) {
+        transform.pos += velocity.linear * dt;
+        transform.hpr += velocity.angular * dt;
+    });
+}
+
+// Writes every 'Transform' to its node in a single pass through 'batch', which the caller
+// keeps between frames so its arrays are reused, see 'TransformBatch' for threading and
+// skipping unchanged nodes.
+template <typename Store>
+void write_transforms(Store& store, TransformBatch& batch) {
+    const std::vector<Transform>& transforms = store.template column<Transform>();
+    const std::vector<NodePath>&  nodes      = store.nodes();
+
+    // rows are reordered when entities are destroyed, so the batch is refilled every call
+    // from the store alone, the nodes are only touched by the final write
+    batch.clear();
+    batch.reserve(transforms.size());
+
+    LQuaternion quat;
+    for (size_t i = 0; i < transforms.size(); ++i) {
+        if (nodes[i].is_empty())
+            continue;
+
+        quat.set_hpr(transforms[i].hpr);
+        batch.add(nodes[i], transforms[i].pos, quat, transforms[i].scale);
+    }
+
+    batch.commit();
+}
+
+// Reads the current node transforms back into the store, e.g. after the scene editor moved them.
+template <typename Store>
+void read_transforms(Store& store) {
+    std::vector<Transform>&      transforms = store.template column<Transform>();
+    const std::vector<NodePath>& nodes      = store.nodes();
+
+    for (size_t i = 0; i < transforms.size(); ++i) {
+        if (nodes[i].is_empty())
+            continue;
+
+        CPT(TransformState) state = nodes[i].node()->get_transform();
+        transforms[i].pos = state->get_pos();
+        transforms[i].hpr = state->get_hpr();
+        transforms[i].scale = state->get_scale();
+    }
+}
+
+#endif // COMPONENT_STORE_H
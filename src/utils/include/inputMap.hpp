@@ -0,0 +1,83 @@
+#ifndef INPUT_MAP_H
+#define INPUT_MAP_H
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+#include <buttonHandle.h>
+#include <mouseWatcher.h>
+
+// Named input actions bound to buttons, polled once per frame into bitsets so controllers
+// read them by index instead of matching event strings. Declare the actions and axes once,
+// keep the returned indices and bind any number of buttons to each action, e.g.
+//
+//     int jump = input.add_action("jump");
+//     input.bind(jump, KeyboardButton::space());
+//     ...
+//     if (input.was_pressed(jump)) ...
+//
+// 'pressed' and 'released' edges accumulate across 'update' calls until 'clear_edges', so
+// a press is not lost when a frame runs no fixed simulation step.
+class InputMap {
+public:
+    static constexpr int MAX_ACTIONS = 64;
+    typedef std::bitset<MAX_ACTIONS> ActionBits;
+
+    // returns the index of an already declared action with the same name
+    int  add_action(const std::string& name);
+    int  find_action(const std::string& name) const;  // -1 if not declared
+    const std::string& get_action_name(int action) const { return actions_[action]; }
+    int  get_num_actions() const { return static_cast<int>(actions_.size()); }
+
+    void bind(int action, const ButtonHandle& button);
+    void bind(int action, const std::string& button_name);  // looked up in the ButtonRegistry once
+    void unbind(int action);
+
+    // -1 while only 'negative' is held, 1 while only 'positive' is held, 0 otherwise,
+    // undeclared actions are stored as -1 and never held
+    int  add_axis(const std::string& name, int negative, int positive);
+    int  find_axis(const std::string& name) const;
+    int  get_num_axes() const { return static_cast<int>(axes_.size()); }
+
+    // samples every binding from the watcher's button state
+    void update(const MouseWatcher* watcher);
+    void clear_edges();
+    // releases everything without reporting edges, e.g. when the game loses input
+    void reset();
+
+    // false, or 0 for axes, for indices that are not valid, e.g. the -1 of 'find_action'
+    bool  is_held(int action) const      { return is_valid(action) && held_.test(action); }
+    bool  was_pressed(int action) const  { return is_valid(action) && pressed_.test(action); }
+    bool  was_released(int action) const { return is_valid(action) && released_.test(action); }
+    float get_axis(int axis) const       { return axis >= 0 && axis < get_num_axes() ? axis_values_[axis] : 0.0f; }
+
+    const ActionBits& get_held() const     { return held_; }
+    const ActionBits& get_pressed() const  { return pressed_; }
+    const ActionBits& get_released() const { return released_; }
+
+private:
+    struct Binding {
+        ButtonHandle button;
+        int          action;
+    };
+
+    struct Axis {
+        std::string name;
+        int         negative;
+        int         positive;
+    };
+
+    std::vector<std::string> actions_;
+    std::vector<Binding>     bindings_;
+    std::vector<Axis>        axes_;
+    std::vector<float>       axis_values_;
+
+    ActionBits held_;
+    ActionBits pressed_;
+    ActionBits released_;
+
+    static bool is_valid(int action) { return action >= 0 && action < MAX_ACTIONS; }
+};
+
+#endif // INPUT_MAP_H
@@ -0,0 +1,103 @@
+#ifndef LABEL_MANAGER_H
+#define LABEL_MANAGER_H
+
+#include <string>
+#include <vector>
+
+#include <nodePath.h>
+
+#include "textBatch.hpp"
+
+class OcclusionCuller;
+
+// Screen-space labels for many world positions (NPC names, waypoints) without a scene
+// graph node per label. Every 'update' projects all anchors in one batch, drops labels
+// that are behind the camera, off screen, too far or occluded, then places the rest in
+// priority order (closest first within a priority) rejecting any that would overlap an
+// already placed label. Survivors are drawn by a single TextBatch.
+//
+// 'overlay' must be a 2D root spanning -1..1 over the camera's display region, such as
+// 'Game::render2D' for 'Game::main_cam' or 'Engine::render2D' for the scene camera.
+class LabelManager {
+public:
+    LabelManager(const NodePath& camera, const NodePath& root, const NodePath& overlay, TextFont* font = nullptr);
+    ~LabelManager();
+
+    // follows 'anchor', 'offset' is in the anchor's space
+    int  add(const std::string& text, const NodePath& anchor, const LVecBase3& offset = LVecBase3(0), int priority = 0);
+    // fixed position in root space
+    int  add(const std::string& text, const LPoint3& position, int priority = 0);
+    void remove(int id);
+    void clear();
+
+    void set_text(int id, const std::string& text);
+    void set_color(int id, const LColorf& color);
+    void set_priority(int id, int priority);
+    void set_position(int id, const LPoint3& position);
+
+    // labels are hidden when the culler's depth buffer has something in front of the anchor
+    void set_occlusion_culler(const OcclusionCuller* culler) { culler_ = culler; }
+    void set_max_distance(float distance) { max_distance_ = distance; }
+    void set_declutter(bool declutter) { declutter_ = declutter; }
+    // text height as a fraction of the display region height
+    void set_scale(float scale) { scale_ = scale; }
+
+    void update();
+
+    int get_num_labels() const { return static_cast<int>(labels_.size() - free_ids_.size()); }
+    int get_num_visible() const { return num_visible_; }  // after the last 'update'
+
+    TextBatch& get_batch() { return batch_; }
+
+private:
+    struct Label {
+        std::string text;
+        NodePath    anchor;
+        LVecBase3   offset;
+        LPoint3     position;
+        LVecBase2f  size;  // unscaled text size from TextBatch::measure
+        int         priority = 0;
+        int         batch_id = -1;
+        bool        alive = false;
+    };
+
+    struct Candidate {
+        int   id;
+        float x, y, depth;
+    };
+
+    struct Rect {
+        float left, bottom, right, top;
+    };
+
+    NodePath  camera_;
+    NodePath  root_;
+    TextBatch batch_;
+
+    const OcclusionCuller* culler_;
+    float max_distance_;
+    float scale_;
+    bool  declutter_;
+    int   num_visible_;
+
+    std::vector<Label> labels_;
+    std::vector<int>   free_ids_;
+
+    // structure of arrays for the projection batch, padded to a multiple of 4
+    std::vector<int>   ids_;
+    std::vector<float> xs_, ys_, zs_;
+    std::vector<float> ndc_x_, ndc_y_, ndc_z_, ws_;
+
+    std::vector<Candidate>         candidates_;
+    std::vector<Rect>              placed_;
+    std::vector<std::vector<int>>  grid_;
+
+    static constexpr int GRID_SIZE = 16;  // declutter cells per axis
+
+    int  create(const std::string& text, int priority);
+    void project(const LMatrix4& view_proj, size_t count);
+    bool is_occluded(float x, float y, float depth) const;
+    bool place(const Rect& rect);
+};
+
+#endif // LABEL_MANAGER_H
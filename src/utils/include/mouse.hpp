@@ -1,23 +1,49 @@
 #ifndef MOUSE_H
 #define MOUSE_H
 
-#include <unordered_map>
-#include <vector>
+#include <bitset>
 #include <string>
+#include <vector>
+
+#include <buttonHandle.h>
+#include <graphicsWindowInputDevice.h>
 
 class Engine;
 
 class Mouse {
 public:
+	// button and modifier state, bit 'i' is the button whose ButtonHandle index is 'i'
+	static constexpr int MAX_BUTTONS = 512;
+	typedef std::bitset<MAX_BUTTONS> ButtonBits;
+	
+	// one pointer motion between two events, in pixels (or raw device counts) with y down
+	struct Motion {
+		float  dx;
+		float  dy;
+		double time;
+	};
+	
     Mouse(Engine& _engine);
+	~Mouse();
 	void initialize();
+	// drains the window's pointer events, must run before the data graph traversal
+	// which would otherwise consume them
+	void capture();
     void update();
 	void force_relative_mode();
     void clear_modifier(int index);
 	void toggle_force_relative_mode();
     bool has_modifier(int modifier) const;
     bool has_mouse() const;
-	bool is_button_down(const std::string& buttonName) const;
+	bool is_button_down(const ButtonHandle& button) const;
+	bool is_button_down(const std::string& buttonName) const; // looks the handle up by name
+	
+	// Reads relative motion from an evdev device instead of the window, unaccelerated and
+	// not limited by the screen edges. Linux only and the device must be readable by the
+	// user, an empty 'device_path' picks the first relative pointer in /dev/input.
+	bool enable_raw_input(const std::string& device_path = "");
+	void disable_raw_input();
+	bool is_raw_input() const;
 
     // Getters
 	float get_x()  const;
@@ -31,7 +57,16 @@ public:
 	
 	bool is_mouse_centered() const;
 	
-	const std::unordered_map<std::string, bool>& get_mouse_buttons() const;
+	const ButtonBits& get_buttons() const;
+	
+	// the motion events summed into this frame's 'get_dx' and 'get_dy', oldest first
+	const std::vector<Motion>& get_motion_history() const;
+	// captured since the last 'update', read by 'InputRecorder'
+	const std::vector<Motion>& get_pending_motion() const;
+	
+	// while replaying the window is ignored and 'replay' provides the pointer every frame
+	void set_replaying(bool replaying);
+	void replay(float x, float y, const std::vector<Motion>& motions);
 	
 	// Setters
 	void set_modifier(int index);
@@ -53,8 +88,29 @@ private:
 	bool _force_relative_mode;
 	
 	Engine& _engine;
-    std::unordered_map<std::string, bool> _mouse_buttons;
-    std::vector<int> _modifiers;
+	ButtonBits _buttons;
+	ButtonBits _modifiers;
+	
+	// pointer events between frames, 'false' when the window doesn't buffer them
+	bool _has_pointer_events;
+	bool _has_last_event;
+	double _last_event_x;
+	double _last_event_y;
+	
+	std::vector<Motion> _pending;
+	std::vector<Motion> _history;
+	
+	int _raw_fd; // evdev file descriptor, -1 when raw input is off
+	float _raw_report_x;
+	float _raw_report_y;
+	
+	bool _replaying;
+	float _replay_x;
+	float _replay_y;
+	
+	GraphicsWindowInputDevice* get_pointer_device() const;
+	void read_pointer_events();
+	void read_raw_events();
 };
 
 #endif // MOUSE_H
@@ -1,19 +1,31 @@
 #ifndef RUNTIME_SCRIPT_H
 #define RUNTIME_SCRIPT_H
 
+#include <cmath>
+
+#include <datagram.h>
+#include <datagramIterator.h>
+
 #include "demon.hpp"
 #include "mouse.hpp"
+#include "inputMap.hpp"
 #include "game.hpp"
 #include "taskUtils.hpp"
 #include "mathUtils.hpp"
 
+// Bumped whenever the RuntimeScript layout or the module entry points change, so stale
+// modules are rejected by the 'ScriptHost' instead of crashing it.
+#define RUNTIME_SCRIPT_API_VERSION 2
+
 class RuntimeScript {
 public:
     RuntimeScript() :
         demon(Demon::get_instance()),
         mouse(demon.engine.mouse),
         resource_manager(demon.engine.resource_manager),
-        game(demon.game) {
+        game(demon.game),
+        dt(0.0f),
+        alpha(0.0f) {
         
         // ----------------------------------------------------------- //
 		// Create update task
@@ -24,7 +36,16 @@ public:
 				demon.engine.mouse.is_mouse_centered()))
 			{
 				dt = ClockObject::get_global_clock()->get_dt();
+				input.update(game.mouse_watcher);
+				
+				if (fixed_dt_ > 0.0f)
+					this->step_simulation();
+				
 				this->on_update(task);
+				
+				// without fixed steps the edges belong to this frame's 'on_update'
+				if (fixed_dt_ <= 0.0f)
+					input.clear_edges();
 			}
 			
 			return AsyncTask::DS_cont;
@@ -32,15 +53,29 @@ public:
 
         // ----------------------------------------------------------- //
         // Hook event listener
-        demon.engine.accept([this](const std::string& event_name) { this->on_event(event_name); });
-        demon.engine.accept("game_mode_enabled",  [this]() { this->start_update_task(); });
-        demon.engine.accept("game_mode_disabled", [this]() { this->stop_update_task(); });
+        // callbacks are owned by this script so they can be dropped when it is destroyed,
+        // which is required when the script lives in a module that is about to be unloaded.
+        demon.engine.accept([this](const std::string& event_name) { this->on_event(event_name); }, this);
+        demon.engine.accept("game_mode_enabled",  [this]() { this->start_update_task(); }, this);
+        demon.engine.accept("game_mode_disabled", [this]() { this->stop_update_task(); input.reset(); }, this);
+        // an input replay forces the clock and only restores its mode, not the render rate
+        demon.engine.accept("input-replay-done", [this]() {
+            if (render_rate_ > 0.0f && has_task(task_name))
+                this->apply_render_rate();
+        }, this);
     }
 
     virtual ~RuntimeScript() {
+        demon.engine.ignore_all(this);
         remove_task(task_name);
     }
 	
+	// Serializes whatever state should survive a hot reload, 'load_state' of the reloaded
+	// instance receives the same data. Loaded resources stay resident in the model and
+	// texture pools, only script state has to be carried over.
+	virtual void save_state(Datagram& dg) const {}
+	virtual void load_state(DatagramIterator& scan) {}
+	
 	void start() {
         demon.start();
     }
@@ -49,9 +84,29 @@ public:
 	
 	int get_priority() { return -1; }
 	
-	const std::unordered_map<std::string, bool>& get_buttons_map() {
-		return input_map;
+	const InputMap& get_input() const {
+		return input;
 	}
+	
+	// Runs 'on_fixed_update' at a constant 'sim_rate' (in Hz) decoupled from the render frame
+	// rate, at most 'max_steps' per frame, time that could not be caught up with is dropped.
+	// A 'sim_rate' of 0 disables fixed stepping, which is the default.
+	void set_sim_rate(float sim_rate, int max_steps = 5) {
+		fixed_dt_ = sim_rate > 0.0f ? 1.0f / sim_rate : 0.0f;
+		max_steps_ = max_steps > 0 ? max_steps : 1;
+		accumulator_ = 0.0f;
+	}
+	
+	// Caps the render frame rate (in Hz) while this script's game is running, 0 means uncapped,
+	// this sets the global clock so it affects the whole application.
+	void set_render_rate(float render_rate) {
+		render_rate_ = render_rate;
+		if (has_task(task_name))
+			apply_render_rate();
+	}
+	
+	float get_sim_rate() const { return fixed_dt_ > 0.0f ? 1.0f / fixed_dt_ : 0.0f; }
+	float get_render_rate() const { return render_rate_; }
     
 protected:
     Demon&           demon;
@@ -60,44 +115,73 @@ protected:
     Game&            game;
 	
 	float dt;
-	std::unordered_map<std::string, bool> input_map;
+	float alpha; // fraction of a simulation step left in the accumulator, to blend render state
+	InputMap input; // sampled at the start of every frame, declare actions in the constructor
 
     template <typename Callable>
     void accept(const std::string& event_name, Callable callable) {
-        demon.engine.accept(event_name, callable);
+        // owned by this script, see the event hooks in the constructor
+        demon.engine.accept(event_name, std::function<void()>(callable), this);
     }
 	
-	void register_button_map(std::unordered_map<std::string, std::pair<std::string, bool>>& map) {
-		input_map.clear();
-		buttons_map_ = map;
-		
-		// fill key map
-		for (auto& it : buttons_map_) {
-			if (input_map.find(it.second.first) == input_map.end()) {
-				input_map[it.second.first] = false;
-			}
-		}
-	}
-	
     virtual void on_update(const PT(AsyncTask)&) {}
 	
-    virtual void on_event(const std::string& event_name) {
-		// update input_map
-		auto& it = buttons_map_.find(event_name);
-		if (it != buttons_map_.end()) {
-			input_map[it->second.first] = it->second.second;
-		}		
-	}
+	// called zero or more times per frame with a constant 'fixed_dt' when a sim rate is set
+	virtual void on_fixed_update(float fixed_dt) {}
+	
+	// called once per frame after the simulation steps, with 'alpha' in [0, 1)
+	virtual void on_render(float alpha) {}
+	
+    virtual void on_event(const std::string& event_name) {}
 	
 	float get_dt() {
 		return ClockObject::get_global_clock()->get_dt();
 	}
 
 private:
+	friend class ScriptHost;
+	
     std::string task_name;
 	
 	PT(AsyncTask) update_task;
-    std::unordered_map<std::string, std::pair<std::string, bool>> buttons_map_;
+	
+	// fixed timestep
+	float fixed_dt_    = 0.0f;
+	float accumulator_ = 0.0f;
+	int   max_steps_   = 5;
+	float render_rate_ = 0.0f;
+	
+	void step_simulation() {
+		accumulator_ += dt;
+		
+		int steps = 0;
+		while (accumulator_ >= fixed_dt_ && steps < max_steps_) {
+			this->on_fixed_update(fixed_dt_);
+			accumulator_ -= fixed_dt_;
+			++steps;
+			
+			// a press is seen by one step only, frames without a step keep it for the next
+			input.clear_edges();
+		}
+		
+		// avoid the spiral of death after a hitch, keep only the fractional step
+		if (accumulator_ >= fixed_dt_)
+			accumulator_ = std::fmod(accumulator_, fixed_dt_);
+		
+		alpha = accumulator_ / fixed_dt_;
+		this->on_render(alpha);
+	}
+	
+	void apply_render_rate() {
+		ClockObject* clock = ClockObject::get_global_clock();
+		if (render_rate_ > 0.0f) {
+			clock->set_mode(ClockObject::M_limited);
+			clock->set_frame_rate(render_rate_);
+		}
+		else {
+			clock->set_mode(ClockObject::M_normal);
+		}
+	}
 	
 	void start_update_task() {
         // Get derived class name
@@ -109,13 +193,35 @@ private:
         task_name += "Task";
 
 		update_task->set_name(task_name);
-		if (!has_task(task_name))
+		if (!has_task(task_name)) {
+			accumulator_ = 0.0f;
+			alpha = 0.0f;
 			AsyncTaskManager::get_global_ptr()->add(update_task);
+			
+			if (render_rate_ > 0.0f)
+				apply_render_rate();
+		}
 	}
 	
 	void stop_update_task() {
 		remove_task(task_name); // defined in taskUtils.hpp
+		
+		if (render_rate_ > 0.0f)
+			ClockObject::get_global_clock()->set_mode(ClockObject::M_normal);
 	}
 };
 
+// Exports the entry points used by 'ScriptHost' to create and destroy 'ScriptClass' from a
+// shared library, use once per module, e.g. RUNTIME_SCRIPT_MODULE(RoamingRalphDemo)
+#if defined(__WIN32__) || defined(_WIN32)
+#define RUNTIME_SCRIPT_EXPORT extern "C" __declspec(dllexport)
+#else
+#define RUNTIME_SCRIPT_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#define RUNTIME_SCRIPT_MODULE(ScriptClass)                                                     \
+	RUNTIME_SCRIPT_EXPORT int runtime_script_api_version() { return RUNTIME_SCRIPT_API_VERSION; } \
+	RUNTIME_SCRIPT_EXPORT RuntimeScript* create_runtime_script() { return new ScriptClass(); }     \
+	RUNTIME_SCRIPT_EXPORT void destroy_runtime_script(RuntimeScript* script) { delete script; }
+
 #endif // RUNTIME_SCRIPT_H
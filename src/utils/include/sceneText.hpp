@@ -16,9 +16,11 @@ public:
 
     SceneText(const std::string& name, TextStyle style = TS_plain);
     SceneText(const SceneText& other);
+    SceneText(SceneText&& other) noexcept;
     ~SceneText();
 
 	SceneText& operator=(const SceneText& other);
+	SceneText& operator=(SceneText&& other) noexcept;
 
 	void cleanup();
   	void clear_text();
@@ -65,11 +67,20 @@ private:
    static const float MARGIN;
    static const float SHADOW;
    
-   void swap(SceneText& other);
    void duplicate_parenting(const SceneText& other);
+   bool detach();  // false for a moved from text, which has no node to change
+   void update_transform_mat();
 
+   // Copies share one text node, and so its generated geometry, instanced under their
+   // own holder node which carries the per copy transform. The first text property
+   // change on a shared copy clones the node (copy on write). Moved from texts have
+   // no node, their setters do nothing and their getters return defaults.
    struct TextNodeProxy;
    PT(TextNodeProxy) m_textNode;
+   
+   LVecBase2f m_scale;
+   LVecBase2f m_pos;
+   float m_roll;
 };
 
 #endif /* ONSCREENTEXT_H_ */
@@ -0,0 +1,64 @@
+#ifndef SCRIPT_HOST_H
+#define SCRIPT_HOST_H
+
+#include <string>
+#include <vector>
+
+#include <asyncTask.h>
+#include <datagram.h>
+
+class RuntimeScript;
+
+// Loads 'RuntimeScript's from shared libraries built with RUNTIME_SCRIPT_MODULE and reloads
+// them in place when the library on disk changes. The old instance's 'save_state' output is
+// handed to the new instance's 'load_state', resources stay cached in the model / texture pools.
+class ScriptHost {
+public:
+	ScriptHost();
+	~ScriptHost();
+
+	ScriptHost(const ScriptHost&) = delete;
+	ScriptHost& operator=(const ScriptHost&) = delete;
+
+	bool load(const std::string& path);
+	bool reload(const std::string& path);
+	void unload(const std::string& path);
+	void unload_all();
+
+	// how often (in seconds) loaded libraries are checked for changes, 0 disables watching
+	void set_poll_interval(double interval);
+
+	RuntimeScript* get_script(const std::string& path) const;
+	size_t get_num_modules() const { return modules_.size(); }
+
+private:
+	typedef int            (*ApiVersionFn)();
+	typedef RuntimeScript* (*CreateFn)();
+	typedef void           (*DestroyFn)(RuntimeScript*);
+
+	struct Module {
+		std::string    path;         // library as built
+		std::string    loaded_path;  // private copy that is actually opened
+		void*          handle        = nullptr;
+		RuntimeScript* script        = nullptr;
+		DestroyFn      destroy       = nullptr;
+		time_t         timestamp     = 0;
+		time_t         pending_stamp = 0;
+		int            generation    = 0;
+		Datagram       state;        // kept until a reload succeeds
+	};
+
+	std::vector<Module> modules_;
+	PT(AsyncTask)       watch_task_;
+	double              poll_interval_;
+	double              last_poll_;
+
+	Module* find_module(const std::string& path);
+	const Module* find_module(const std::string& path) const;
+
+	bool open_module(Module& module);
+	void close_module(Module& module);
+	void poll();
+};
+
+#endif // SCRIPT_HOST_H
@@ -0,0 +1,115 @@
+#ifndef TEXT_BATCH_H
+#define TEXT_BATCH_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <nodePath.h>
+#include <geom.h>
+#include <renderState.h>
+#include <textFont.h>
+#include <textNode.h>
+
+// Draws many short strings (HUD labels, debug stats) from a single GeomNode. Glyphs come
+// from the font's shared texture pages and every page is one Geom, so all labels normally
+// end up in a single draw call. Each label owns a range of quads in its page's dynamic
+// vertex buffer, 'update' rewrites only the labels that changed since the last call.
+//
+// Labels are laid out like a TextNode in the XZ plane, parent the batch to aspect2D,
+// pixel2D or a billboard in the 3D scene. Unlike SceneText there is no card, frame,
+// shadow or word wrap, use SceneText for styled one-off text.
+class TextBatch : public NodePath {
+public:
+    TextBatch(const std::string& name, TextFont* font = nullptr);
+
+    int  add(const std::string& text,
+             const LVecBase2f& pos,
+             float scale = 0.07f,
+             const LColorf& color = LColorf(1, 1, 1, 1),
+             TextNode::Alignment align = TextNode::A_left);
+    void remove(int id);
+    void clear();
+
+    // setters only mark the label, geometry is written by 'update'
+    void set_text(int id, const std::string& text);
+    void set_pos(int id, const LVecBase2f& pos);
+    void set_scale(int id, float scale);
+    void set_scale(int id, const LVecBase2f& scale);
+    void set_color(int id, const LColorf& color);
+    void set_align(int id, TextNode::Alignment align);
+    // hidden labels keep their quads reserved, showing them again doesn't reallocate
+    void set_visible(int id, bool visible);
+
+    // width of the widest line and total height in font units, multiply by the scale
+    LVecBase2f measure(const std::string& text) const;
+
+    const std::string& get_text(int id) const;
+    bool   is_valid(int id) const;
+    size_t get_num_labels() const { return labels_.size() - free_ids_.size(); }
+
+    // writes the changed labels, call once per frame after the labels were set
+    void update();
+    int  get_num_updated() const { return num_updated_; }  // by the last 'update'
+
+private:
+    struct Allocation {
+        int layer;
+        int first;     // quad index
+        int capacity;  // quads
+        int used;
+    };
+
+    struct Label {
+        std::string             text;
+        LVecBase2f              pos;
+        LVecBase2f              scale;
+        LColorf                 color;
+        TextNode::Alignment     align;
+        bool                    alive = false;
+        bool                    dirty = false;
+        bool                    visible = true;
+        std::vector<Allocation> allocations;
+    };
+
+    struct Range {
+        int first;
+        int count;
+    };
+
+    // one per font texture page
+    struct Layer {
+        CPT(RenderState)   state;
+        PT(Geom)           geom;
+        int                capacity = 0;  // quads
+        int                end = 0;       // first never allocated quad
+        std::vector<Range> free_ranges;
+    };
+
+    struct GlyphQuad {
+        int       layer;
+        LVecBase4 dimensions;  // left, bottom, right, top
+        LVecBase4 texcoords;
+    };
+
+    PT(TextFont)       font_;
+    PT(GeomNode)       geom_node_;
+    std::vector<Label> labels_;
+    std::vector<int>   free_ids_;
+    std::vector<Layer> layers_;
+    std::unordered_map<const RenderState*, int> layer_lookup_;
+    std::vector<int>   dirty_ids_;
+    int                num_updated_;
+
+    void mark_dirty(int id);
+    void layout(const Label& label, std::vector<GlyphQuad>& quads);
+    int  get_layer(const RenderState* state);
+
+    Allocation allocate(int layer, int count);
+    void       release(const Allocation& allocation);
+    void       grow(Layer& layer, int capacity);
+    void       write_quads(const Label& label, const Allocation& allocation, const std::vector<GlyphQuad>& quads);
+    void       zero_quads(Layer& layer, int first, int count);
+};
+
+#endif // TEXT_BATCH_H
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <iostream>
+
+#include <buttonRegistry.h>
+
+#include "inputMap.hpp"
+
+int InputMap::add_action(const std::string& name) {
+    int action = find_action(name);
+    if (action >= 0)
+        return action;
+
+    if (get_num_actions() >= MAX_ACTIONS) {
+        std::cerr << "InputMap: too many actions, '" << name << "' was not added" << std::endl;
+        return -1;
+    }
+
+    actions_.push_back(name);
+    return get_num_actions() - 1;
+}
+
+int InputMap::find_action(const std::string& name) const {
+    auto it = std::find(actions_.begin(), actions_.end(), name);
+    return it != actions_.end() ? static_cast<int>(it - actions_.begin()) : -1;
+}
+
+void InputMap::bind(int action, const ButtonHandle& button) {
+    if (action < 0 || action >= get_num_actions() || button == ButtonHandle::none())
+        return;
+
+    bindings_.push_back({ button, action });
+}
+
+void InputMap::bind(int action, const std::string& button_name) {
+    ButtonHandle button = ButtonRegistry::ptr()->find_button(button_name);
+    if (button == ButtonHandle::none()) {
+        std::cerr << "InputMap: unknown button '" << button_name << "'" << std::endl;
+        return;
+    }
+
+    bind(action, button);
+}
+
+void InputMap::unbind(int action) {
+    bindings_.erase(std::remove_if(bindings_.begin(), bindings_.end(),
+                                   [action](const Binding& binding) { return binding.action == action; }),
+                    bindings_.end());
+}
+
+int InputMap::add_axis(const std::string& name, int negative, int positive) {
+    if (negative < 0 || negative >= get_num_actions())
+        negative = -1;
+    if (positive < 0 || positive >= get_num_actions())
+        positive = -1;
+
+    int axis = find_axis(name);
+    if (axis < 0) {
+        axis = get_num_axes();
+        axes_.push_back({ name, negative, positive });
+        axis_values_.push_back(0.0f);
+    }
+    else {
+        axes_[axis].negative = negative;
+        axes_[axis].positive = positive;
+    }
+
+    return axis;
+}
+
+int InputMap::find_axis(const std::string& name) const {
+    for (int axis = 0; axis < get_num_axes(); ++axis) {
+        if (axes_[axis].name == name)
+            return axis;
+    }
+
+    return -1;
+}
+
+void InputMap::update(const MouseWatcher* watcher) {
+    ActionBits held;
+    if (watcher) {
+        for (const Binding& binding : bindings_) {
+            if (watcher->is_button_down(binding.button))
+                held.set(binding.action);
+        }
+    }
+
+    pressed_  |= held & ~held_;
+    released_ |= held_ & ~held;
+    held_ = held;
+
+    for (size_t i = 0; i < axes_.size(); ++i) {
+        const Axis& axis = axes_[i];
+        const bool negative = axis.negative >= 0 && held_.test(axis.negative);
+        const bool positive = axis.positive >= 0 && held_.test(axis.positive);
+        axis_values_[i] = static_cast<float>(positive) - static_cast<float>(negative);
+    }
+}
+
+void InputMap::clear_edges() {
+    pressed_.reset();
+    released_.reset();
+}
+
+void InputMap::reset() {
+    held_.reset();
+    clear_edges();
+    std::fill(axis_values_.begin(), axis_values_.end(), 0.0f);
+}
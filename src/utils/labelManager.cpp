@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LABEL_MANAGER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <camera.h>
+#include <lens.h>
+
+#include "occlusionCuller.hpp"
+#include "labelManager.hpp"
+
+// anchors closer than this (in clip space w) are behind or at the camera
+static const float MIN_W = 1e-4f;
+
+LabelManager::LabelManager(const NodePath& camera, const NodePath& root, const NodePath& overlay, TextFont* font) :
+    camera_(camera),
+    root_(root),
+    batch_("Labels", font),
+    culler_(nullptr),
+    max_distance_(0.0f),
+    scale_(0.04f),
+    declutter_(true),
+    num_visible_(0) {
+
+    batch_.reparent_to(overlay);
+    grid_.resize(GRID_SIZE * GRID_SIZE);
+}
+
+LabelManager::~LabelManager() {
+    batch_.remove_node();
+}
+
+int LabelManager::add(const std::string& text, const NodePath& anchor, const LVecBase3& offset, int priority) {
+    int id = create(text, priority);
+    labels_[id].anchor = anchor;
+    labels_[id].offset = offset;
+    return id;
+}
+
+int LabelManager::add(const std::string& text, const LPoint3& position, int priority) {
+    int id = create(text, priority);
+    labels_[id].position = position;
+    return id;
+}
+
+void LabelManager::remove(int id) {
+    if (id < 0 || id >= static_cast<int>(labels_.size()) || !labels_[id].alive)
+        return;
+
+    Label& label = labels_[id];
+    batch_.remove(label.batch_id);
+    label.anchor.clear();
+    label.alive = false;
+    free_ids_.push_back(id);
+}
+
+void LabelManager::clear() {
+    for (int id = 0; id < static_cast<int>(labels_.size()); ++id)
+        remove(id);
+}
+
+void LabelManager::set_text(int id, const std::string& text) {
+    Label& label = labels_[id];
+    if (label.text == text)
+        return;
+
+    label.text = text;
+    label.size = batch_.measure(text);
+    batch_.set_text(label.batch_id, text);
+}
+
+void LabelManager::set_color(int id, const LColorf& color) {
+    batch_.set_color(labels_[id].batch_id, color);
+}
+
+void LabelManager::set_priority(int id, int priority) {
+    labels_[id].priority = priority;
+}
+
+void LabelManager::set_position(int id, const LPoint3& position) {
+    labels_[id].anchor.clear();
+    labels_[id].position = position;
+}
+
+int LabelManager::create(const std::string& text, int priority) {
+    int id;
+    if (!free_ids_.empty()) {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+    else {
+        id = static_cast<int>(labels_.size());
+        labels_.emplace_back();
+    }
+
+    Label& label = labels_[id];
+    label = Label();
+    label.text = text;
+    label.size = batch_.measure(text);
+    label.priority = priority;
+    label.alive = true;
+
+    // shown by the next 'update' if it survives culling
+    label.batch_id = batch_.add(text, LVecBase2f(0, 0), scale_, LColorf(1, 1, 1, 1), TextNode::A_center);
+    batch_.set_visible(label.batch_id, false);
+    return id;
+}
+
+void LabelManager::update() {
+    num_visible_ = 0;
+    if (camera_.is_empty())
+        return;
+
+    const Lens* lens = DCAST(Camera, camera_.node())->get_lens();
+    if (!lens)
+        return;
+
+    // gather anchor positions, scene graph reads stay out of the projection loop
+    ids_.clear();
+    xs_.clear();
+    ys_.clear();
+    zs_.clear();
+
+    for (int id = 0; id < static_cast<int>(labels_.size()); ++id) {
+        const Label& label = labels_[id];
+        if (!label.alive)
+            continue;
+
+        const LPoint3 p = label.anchor.is_empty() ? label.position : root_.get_relative_point(label.anchor, label.offset);
+        ids_.push_back(id);
+        xs_.push_back(p[0]);
+        ys_.push_back(p[1]);
+        zs_.push_back(p[2]);
+    }
+
+    const size_t count = ids_.size();
+    const size_t padded = (count + 3) & ~size_t(3);
+    xs_.resize(padded, 0.0f);
+    ys_.resize(padded, 0.0f);
+    zs_.resize(padded, 0.0f);
+
+    project(root_.get_mat(camera_) * lens->get_projection_mat(), padded);
+
+    // cull
+    candidates_.clear();
+    for (size_t i = 0; i < count; ++i) {
+        const int id = ids_[i];
+        const float w = ws_[i];
+
+        // clip space w is the distance along the view axis
+        const bool visible =
+            w > MIN_W &&
+            (max_distance_ <= 0.0f || w <= max_distance_) &&
+            ndc_x_[i] >= -1.0f && ndc_x_[i] <= 1.0f &&
+            ndc_y_[i] >= -1.0f && ndc_y_[i] <= 1.0f &&
+            ndc_z_[i] <= 1.0f &&
+            !is_occluded(ndc_x_[i], ndc_y_[i], ndc_z_[i]);
+
+        if (visible)
+            candidates_.push_back({ id, ndc_x_[i], ndc_y_[i], ndc_z_[i] });
+        else
+            batch_.set_visible(labels_[id].batch_id, false);
+    }
+
+    // declutter, higher priority first then closest first
+    std::sort(candidates_.begin(), candidates_.end(), [this](const Candidate& a, const Candidate& b) {
+        const int pa = labels_[a.id].priority, pb = labels_[b.id].priority;
+        return pa != pb ? pa > pb : a.depth < b.depth;
+    });
+
+    placed_.clear();
+    for (std::vector<int>& cell : grid_)
+        cell.clear();
+
+    const float aspect = lens->get_aspect_ratio();
+    const LVecBase2f scale(scale_ / aspect, scale_);
+
+    for (const Candidate& candidate : candidates_) {
+        const Label& label = labels_[candidate.id];
+
+        // centered on the anchor, the first line's cap height is about one unit of scale
+        const float half_width = label.size[0] * scale[0] * 0.5f;
+        const float top = candidate.y + scale[1];
+        const Rect rect = { candidate.x - half_width, top - label.size[1] * scale[1], candidate.x + half_width, top };
+
+        if (declutter_ && !place(rect)) {
+            batch_.set_visible(label.batch_id, false);
+            continue;
+        }
+
+        batch_.set_pos(label.batch_id, LVecBase2f(candidate.x, candidate.y));
+        batch_.set_scale(label.batch_id, scale);
+        batch_.set_visible(label.batch_id, true);
+        ++num_visible_;
+    }
+
+    batch_.update();
+}
+
+void LabelManager::project(const LMatrix4& m, size_t count) {
+    ndc_x_.resize(count);
+    ndc_y_.resize(count);
+    ndc_z_.resize(count);
+    ws_.resize(count);
+
+    // row vectors, clip[j] = x * m(0, j) + y * m(1, j) + z * m(2, j) + m(3, j)
+#ifdef LABEL_MANAGER_SSE2
+    __m128 col[4][4];
+    for (int j = 0; j < 4; ++j) {
+        for (int i = 0; i < 4; ++i)
+            col[j][i] = _mm_set1_ps(static_cast<float>(m(i, j)));
+    }
+
+    for (size_t i = 0; i < count; i += 4) {
+        const __m128 x = _mm_loadu_ps(&xs_[i]);
+        const __m128 y = _mm_loadu_ps(&ys_[i]);
+        const __m128 z = _mm_loadu_ps(&zs_[i]);
+
+        __m128 clip[4];
+        for (int j = 0; j < 4; ++j) {
+            clip[j] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, col[j][0]), _mm_mul_ps(y, col[j][1])),
+                                 _mm_add_ps(_mm_mul_ps(z, col[j][2]), col[j][3]));
+        }
+
+        // padding and anchors behind the camera divide by a tiny w, they are culled by w anyway
+        const __m128 w = _mm_max_ps(clip[3], _mm_set1_ps(MIN_W));
+        const __m128 inv_w = _mm_div_ps(_mm_set1_ps(1.0f), w);
+
+        _mm_storeu_ps(&ndc_x_[i], _mm_mul_ps(clip[0], inv_w));
+        _mm_storeu_ps(&ndc_y_[i], _mm_mul_ps(clip[1], inv_w));
+        _mm_storeu_ps(&ndc_z_[i], _mm_mul_ps(clip[2], inv_w));
+        _mm_storeu_ps(&ws_[i], clip[3]);
+    }
+#else
+    for (size_t i = 0; i < count; ++i) {
+        const LVecBase4 clip = m.xform(LVecBase4(xs_[i], ys_[i], zs_[i], 1.0f));
+        const float inv_w = 1.0f / std::max(static_cast<float>(clip[3]), MIN_W);
+
+        ndc_x_[i] = clip[0] * inv_w;
+        ndc_y_[i] = clip[1] * inv_w;
+        ndc_z_[i] = clip[2] * inv_w;
+        ws_[i] = clip[3];
+    }
+#endif
+}
+
+bool LabelManager::is_occluded(float x, float y, float depth) const {
+    if (!culler_ || !culler_->is_enabled())
+        return false;
+
+    // same mapping as the culler's rasterizer, normalized depth in 0..1
+    const int px = static_cast<int>((x + 1.0f) * 0.5f * culler_->get_width());
+    const int py = static_cast<int>((y + 1.0f) * 0.5f * culler_->get_height());
+    if (px < 0 || px >= culler_->get_width() || py < 0 || py >= culler_->get_height())
+        return false;
+
+    const float occluder = culler_->get_depth_buffer()[static_cast<size_t>(py) * culler_->get_stride() + px];
+    return occluder < depth * 0.5f + 0.5f;
+}
+
+bool LabelManager::place(const Rect& rect) {
+    auto to_cell = [](float value) {
+        return std::min(GRID_SIZE - 1, std::max(0, static_cast<int>((value + 1.0f) * 0.5f * GRID_SIZE)));
+    };
+
+    const int x0 = to_cell(rect.left), x1 = to_cell(rect.right);
+    const int y0 = to_cell(rect.bottom), y1 = to_cell(rect.top);
+
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            for (int index : grid_[y * GRID_SIZE + x]) {
+                const Rect& other = placed_[index];
+                if (rect.left < other.right && rect.right > other.left &&
+                    rect.bottom < other.top && rect.top > other.bottom)
+                    return false;
+            }
+        }
+    }
+
+    const int index = static_cast<int>(placed_.size());
+    placed_.push_back(rect);
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x)
+            grid_[y * GRID_SIZE + x].push_back(index);
+    }
+
+    return true;
+}
@@ -1,13 +1,45 @@
 #include <algorithm>
+#include <cerrno>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#endif
 
 #include <mouseButton.h>
 #include <keyboardButton.h>
+#include <buttonRegistry.h>
+#include <pointerEventList.h>
 #include "taskUtils.hpp"
 #include "constants.hpp"
 #include "engine.hpp"
 #include "mouse.hpp"
 
-Mouse::Mouse(Engine& _engine) : _engine(_engine) {}
+static bool is_valid_index(int index) {
+	return index >= 0 && index < Mouse::MAX_BUTTONS;
+}
+
+Mouse::Mouse(Engine& _engine) :
+	_x(0), _y(0),
+	_dx(0), _dy(0),
+	_zoom(0),
+	_vertical_axis(0), _horizontal_axis(0),
+	_current_mouse_mode(0),
+	_force_relative_mode(false),
+	_engine(_engine),
+	_has_pointer_events(false),
+	_has_last_event(false),
+	_last_event_x(0), _last_event_y(0),
+	_raw_fd(-1),
+	_raw_report_x(0), _raw_report_y(0),
+	_replaying(false),
+	_replay_x(0), _replay_y(0) {}
+
+Mouse::~Mouse() {
+	disable_raw_input();
+}
 
 void Mouse::initialize() {
 	_engine.accept("alt",        [this]() { this->set_modifier(ALT_KEY_IDX);    });
@@ -15,56 +47,107 @@ void Mouse::initialize() {
 	_engine.accept("control",    [this]() { this->set_modifier(CTRL_KEY_IDX);   });
 	_engine.accept("control-up", [this]() { this->clear_modifier(CTRL_KEY_IDX); });
 	
-	// Initialize mouse button states
-    _mouse_buttons[MouseButton::one().get_name()]   = false;
-    _mouse_buttons[MouseButton::two().get_name()]   = false;
-    _mouse_buttons[MouseButton::three().get_name()] = false;
-    _mouse_buttons[MouseButton::four().get_name()]  = false;
-    _mouse_buttons[MouseButton::five().get_name()]  = false;
+	_buttons.reset();
+	_modifiers.reset();
+	
+	// buffer every pointer move, not just the position at the end of the frame
+	_has_pointer_events = get_pointer_device() != nullptr;
+	if (_has_pointer_events)
+		_engine.win->enable_pointer_events(0);
+}
+
+void Mouse::capture() {
+	// the window keeps buffering while raw input is on, drain it either way
+	if (_has_pointer_events)
+		read_pointer_events();
+	
+	if (_raw_fd >= 0 && !_replaying)
+		read_raw_events();
 }
 
 void Mouse::update() {
-    if (!_engine.mouse_watcher->has_mouse())
+	// whatever was captured belongs to this frame only
+	_history.swap(_pending);
+	_pending.clear();
+	
+    if (!_engine.mouse_watcher->has_mouse()) {
+		_history.clear();
         return;
+	}
 
-    for (auto& btn : _mouse_buttons)
-        _mouse_buttons[btn.first] = _engine.mouse_watcher->is_button_down(btn.first);
+    // one pass over the tracked buttons, no lookups or allocations
+    static const ButtonHandle tracked[] = {
+        MouseButton::one(), MouseButton::two(), MouseButton::three(), MouseButton::four(), MouseButton::five()
+    };
+
+    for (const ButtonHandle& button : tracked) {
+        if (is_valid_index(button.get_index()))
+            _buttons.set(button.get_index(), _engine.mouse_watcher->is_button_down(button));
+    }
 
     // Get pointer from screen, calculate delta
     const MouseData _m_data = _engine.win->get_pointer(0);
+	const float pointer_x = _replaying ? _replay_x : static_cast<float>(_m_data.get_x());
+	const float pointer_y = _replaying ? _replay_y : static_cast<float>(_m_data.get_y());
+	const bool has_motion = _has_pointer_events || _raw_fd >= 0 || _replaying;
+	
+	// every move since the last frame, so nothing is lost when a frame takes longer
+	float motion_x = 0.0f;
+	float motion_y = 0.0f;
+	for (const Motion& motion : _history) {
+		motion_x += motion.dx;
+		motion_y += motion.dy;
+	}
     
 	if (_force_relative_mode) {
-		_dx = _engine.mouse_watcher->get_mouse_x();
-		_dy = _engine.mouse_watcher->get_mouse_y();
-		
-		_horizontal_axis = (_dx > 0) ? 1 : (_dx < 0) ? -1 : 0;
-		_vertical_axis   = (_dy > 0) ? 1 : (_dy < 0) ? -1 : 0;
+		if (has_motion) {
+			// same units as the watcher's position relative to the center, -1 to 1 with y up
+			const WindowProperties props = _engine.win->get_properties();
+			_dx =  motion_x * 2.0f / std::max(1, props.get_x_size());
+			_dy = -motion_y * 2.0f / std::max(1, props.get_y_size());
+		}
+		else {
+			_dx = _engine.mouse_watcher->get_mouse_x();
+			_dy = _engine.mouse_watcher->get_mouse_y();
+		}
 		
 	} else {
-		_dx = _x - _m_data.get_x();
-		_dy = _y - _m_data.get_y();
-		
-		_horizontal_axis = (_dx > 0) ? 1 : (_dx < 0) ? -1 : 0;
-		_vertical_axis   = (_dy > 0) ? 1 : (_dy < 0) ? -1 : 0;
+		if (has_motion) {
+			_dx = -motion_x;
+			_dy = -motion_y;
+		}
+		else {
+			_dx = _x - pointer_x;
+			_dy = _y - pointer_y;
+		}
 
-		_x = _m_data.get_x();
-		_y = _m_data.get_y();
+		_x = pointer_x;
+		_y = pointer_y;
 	}
 	
+	_horizontal_axis = (_dx > 0) ? 1 : (_dx < 0) ? -1 : 0;
+	_vertical_axis   = (_dy > 0) ? 1 : (_dy < 0) ? -1 : 0;
+	
 	if (_force_relative_mode) {
 		force_relative_mode();
 	}
 }
 
 void Mouse::force_relative_mode() {
-	_engine.win->move_pointer(
-		0,
-		static_cast<int>(_engine.win->get_properties().get_x_size() / 2),
-		static_cast<int>(_engine.win->get_properties().get_y_size() / 2));
+	const int center_x = static_cast<int>(_engine.win->get_properties().get_x_size() / 2);
+	const int center_y = static_cast<int>(_engine.win->get_properties().get_y_size() / 2);
+	if (!_replaying)
+		_engine.win->move_pointer(0, center_x, center_y);
+	
+	// the warp is not a move, the next event is measured from the center
+	_last_event_x = center_x;
+	_last_event_y = center_y;
+	_has_last_event = true;
 }
 
 void Mouse::clear_modifier(int index) {
-    _modifiers.erase(std::remove(_modifiers.begin(), _modifiers.end(), index), _modifiers.end());
+    if (is_valid_index(index))
+        _modifiers.reset(index);
 }
 
 void Mouse::toggle_force_relative_mode() {
@@ -73,16 +156,138 @@ void Mouse::toggle_force_relative_mode() {
 }
 
 bool Mouse::has_modifier(int index) const {
-    return std::find(_modifiers.begin(), _modifiers.end(), index) != _modifiers.end();
+    return is_valid_index(index) && _modifiers.test(index);
 }
 
 bool Mouse::has_mouse() const {
     return _engine.mouse_watcher->has_mouse();
 }
 
+bool Mouse::is_button_down(const ButtonHandle& button) const {
+    return is_valid_index(button.get_index()) && _buttons.test(button.get_index());
+}
+
 bool Mouse::is_button_down(const std::string& buttonName) const {
-    auto it = _mouse_buttons.find(buttonName);
-    return (it != _mouse_buttons.end()) ? it->second : false;
+    return is_button_down(ButtonRegistry::ptr()->find_button(buttonName));
+}
+
+bool Mouse::enable_raw_input(const std::string& device_path) {
+#ifdef __linux__
+	disable_raw_input();
+	
+	auto is_relative_pointer = [](int fd) {
+		unsigned long types = 0;
+		unsigned long axes = 0;
+		return ioctl(fd, EVIOCGBIT(0, sizeof(types)), &types) >= 0 && (types & (1ul << EV_REL)) &&
+		       ioctl(fd, EVIOCGBIT(EV_REL, sizeof(axes)), &axes) >= 0 &&
+		       (axes & (1ul << REL_X)) && (axes & (1ul << REL_Y));
+	};
+	
+	if (!device_path.empty()) {
+		_raw_fd = open(device_path.c_str(), O_RDONLY | O_NONBLOCK);
+		if (_raw_fd >= 0 && !is_relative_pointer(_raw_fd))
+			disable_raw_input();
+	}
+	else {
+		for (int i = 0; i < 32 && _raw_fd < 0; ++i) {
+			const std::string path = "/dev/input/event" + std::to_string(i);
+			_raw_fd = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+			if (_raw_fd >= 0 && !is_relative_pointer(_raw_fd))
+				disable_raw_input();
+		}
+	}
+	
+	if (_raw_fd < 0) {
+		std::cout << "Raw mouse input not available, using window pointer events." << std::endl;
+		return false;
+	}
+	
+	_pending.clear();
+	return true;
+#else
+	std::cout << "Raw mouse input is only supported on Linux." << std::endl;
+	return false;
+#endif
+}
+
+void Mouse::disable_raw_input() {
+#ifdef __linux__
+	if (_raw_fd >= 0)
+		close(_raw_fd);
+#endif
+	_raw_fd = -1;
+	_raw_report_x = _raw_report_y = 0.0f;
+	_has_last_event = false;
+}
+
+bool Mouse::is_raw_input() const {
+	return _raw_fd >= 0;
+}
+
+GraphicsWindowInputDevice* Mouse::get_pointer_device() const {
+	if (!_engine.win || _engine.win->get_num_input_devices() == 0)
+		return nullptr;
+	
+	InputDevice* device = _engine.win->get_input_device(0);
+	if (!device || !device->is_of_type(GraphicsWindowInputDevice::get_class_type()))
+		return nullptr;
+	
+	return DCAST(GraphicsWindowInputDevice, device);
+}
+
+void Mouse::read_pointer_events() {
+	GraphicsWindowInputDevice* device = get_pointer_device();
+	if (!device || !device->has_pointer_event())
+		return;
+	
+	// positions rather than the event deltas, so the recentering warp isn't counted
+	PT(PointerEventList) events = device->get_pointer_events();
+	for (size_t i = 0; i < events->get_num_events(); ++i) {
+		if (!events->get_in_window(i)) {
+			_has_last_event = false;
+			continue;
+		}
+		
+		const double x = events->get_xpos(i);
+		const double y = events->get_ypos(i);
+		if (_raw_fd < 0 && !_replaying && _has_last_event && (x != _last_event_x || y != _last_event_y))
+			_pending.push_back({ static_cast<float>(x - _last_event_x), static_cast<float>(y - _last_event_y), events->get_time(i) });
+		
+		_last_event_x = x;
+		_last_event_y = y;
+		_has_last_event = true;
+	}
+}
+
+void Mouse::read_raw_events() {
+#ifdef __linux__
+	// one motion per SYN_REPORT, a report carries both axes of a single device poll
+	input_event events[64];
+	for (;;) {
+		const ssize_t size = read(_raw_fd, events, sizeof(events));
+		if (size <= 0) {
+			if (size < 0 && errno != EAGAIN && errno != EINTR) {
+				std::cout << "Raw mouse device lost, using window pointer events." << std::endl;
+				disable_raw_input();
+			}
+			break;
+		}
+		
+		const size_t count = static_cast<size_t>(size) / sizeof(input_event);
+		for (size_t i = 0; i < count; ++i) {
+			const input_event& event = events[i];
+			if (event.type == EV_REL && event.code == REL_X)
+				_raw_report_x += static_cast<float>(event.value);
+			else if (event.type == EV_REL && event.code == REL_Y)
+				_raw_report_y += static_cast<float>(event.value);
+			else if (event.type == EV_SYN && event.code == SYN_REPORT && (_raw_report_x != 0.0f || _raw_report_y != 0.0f)) {
+				const double time = event.time.tv_sec + event.time.tv_usec * 1e-6;
+				_pending.push_back({ _raw_report_x, _raw_report_y, time });
+				_raw_report_x = _raw_report_y = 0.0f;
+			}
+		}
+	}
+#endif
 }
 
 float Mouse::get_x() const { return _x; }
@@ -105,14 +310,33 @@ bool Mouse::is_mouse_centered() const {
 	return _force_relative_mode || (_current_mouse_mode == WindowProperties::M_relative);
 }
 
-const std::unordered_map<std::string, bool>& Mouse::get_mouse_buttons() const { 
-	return _mouse_buttons; 
+const Mouse::ButtonBits& Mouse::get_buttons() const { 
+	return _buttons; 
+}
+
+const std::vector<Mouse::Motion>& Mouse::get_motion_history() const {
+	return _history;
+}
+
+const std::vector<Mouse::Motion>& Mouse::get_pending_motion() const {
+	return _pending;
+}
+
+void Mouse::set_replaying(bool replaying) {
+	_replaying = replaying;
+	_pending.clear();
+	_has_last_event = false;
+}
+
+void Mouse::replay(float x, float y, const std::vector<Motion>& motions) {
+	_replay_x = x;
+	_replay_y = y;
+	_pending = motions;
 }
 
 void Mouse::set_modifier(int index) {
-    if (std::find(_modifiers.begin(), _modifiers.end(), index) == _modifiers.end()) {
-        _modifiers.push_back(index);
-    }
+    if (is_valid_index(index))
+        _modifiers.set(index);
 }
 
 void Mouse::set_mouse_mode(int requested_mouse_mode) {
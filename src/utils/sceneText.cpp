@@ -12,20 +12,15 @@ struct SceneText::TextNodeProxy : public TextNode
 	TextNodeProxy(const std::string& name, SceneText::TextStyle style);
 	TextNodeProxy(const TextNodeProxy& other);
    
-	LVecBase2f m_scale;
-	LVecBase2f m_pos;
-	float m_roll;
+	LVecBase2f m_scale; // default scale of the style
 	float m_wordwrap;
    
 	virtual ~TextNodeProxy();
-	void update_transform_mat();
 };
 
 SceneText::TextNodeProxy::TextNodeProxy(const std::string& name, SceneText::TextStyle style) : 
 	TextNode(name),
     m_scale(0, 0),
-    m_pos(0, 0),
-    m_roll(0),
     m_wordwrap(0)
 {
    // Set default parameters according to the selected style.
@@ -107,15 +102,11 @@ SceneText::TextNodeProxy::TextNodeProxy(const std::string& name, SceneText::Text
 	  set_frame_color(frame);
 	  set_frame_as_margin(MARGIN, MARGIN, MARGIN, MARGIN);
 	}
-
-	update_transform_mat();
 }
 
 SceneText::TextNodeProxy::TextNodeProxy(const TextNodeProxy& other) : 
 	TextNode(other),
 	m_scale(other.m_scale),
-	m_pos(other.m_pos),
-	m_roll(other.m_roll),
 	m_wordwrap(other.m_wordwrap)
 {
    // empty
@@ -126,27 +117,41 @@ SceneText::TextNodeProxy::~TextNodeProxy()
    // Empty
 }
 
-void SceneText::TextNodeProxy::update_transform_mat()
-{
-	LMatrix4f mat =
-		LMatrix4f::scale_mat(m_scale.get_x(), 1, m_scale.get_y()) *
-		LMatrix4f::rotate_mat(m_roll, LVecBase3f(0, -1, 0)) *
-		LMatrix4f::translate_mat(m_pos.get_x(), 0, m_pos.get_y());
-	set_transform(mat);
+SceneText::SceneText(const std::string& name, TextStyle style) : 
+	m_textNode(new TextNodeProxy(name, style)),
+	m_scale(m_textNode->m_scale),
+	m_pos(0, 0),
+	m_roll(0)
+{
+	// The holder carries the transform, the text node below it may be shared by copies.
+	NodePath::operator=(NodePath(name));
+	node()->add_child(m_textNode);
+	update_transform_mat();
 }
 
-
-SceneText::SceneText(const std::string& name, TextStyle style) : 
-	m_textNode(new TextNodeProxy(name, style))
+SceneText::SceneText(const SceneText& other) :
+	m_textNode(other.m_textNode),
+	m_scale(other.m_scale),
+	m_pos(other.m_pos),
+	m_roll(other.m_roll)
 {
-	// Ok, now update the node.
-	NodePath::operator=(NodePath(m_textNode));
+	// Share the text node, its geometry is only regenerated once a copy changes it.
+	// A moved from text has no node and its copies are left empty as well.
+	if(m_textNode != nullptr)
+	{
+	  duplicate_parenting(other);
+	}
 }
 
-SceneText::SceneText(const SceneText& other) :
-	m_textNode(new TextNodeProxy(*other.m_textNode))
+SceneText::SceneText(SceneText&& other) noexcept :
+	NodePath(std::move(other)),
+	m_textNode(std::move(other.m_textNode)),
+	m_scale(other.m_scale),
+	m_pos(other.m_pos),
+	m_roll(other.m_roll)
 {
-	duplicate_parenting(other);
+	// The node itself changes hands, the moved from text is left empty.
+	other.NodePath::operator=(NodePath());
 }
 
 SceneText::~SceneText()
@@ -156,77 +161,149 @@ SceneText::~SceneText()
 
 SceneText& SceneText::operator=(const SceneText& other)
 {
-	SceneText(other).swap(*this);
-	duplicate_parenting(other);
+	if(this != &other)
+	{
+	  *this = SceneText(other);
+	}
 	return *this;
 }
 
-void SceneText::swap(SceneText& other)
+SceneText& SceneText::operator=(SceneText&& other) noexcept
 {
-	PT(TextNodeProxy) p = m_textNode;
-	m_textNode = other.m_textNode;
-	other.m_textNode = p;
+	if(this != &other)
+	{
+	  cleanup();
+	  
+	  NodePath::operator=(std::move(other));
+	  m_textNode = std::move(other.m_textNode);
+	  m_scale = other.m_scale;
+	  m_pos = other.m_pos;
+	  m_roll = other.m_roll;
+	  
+	  other.NodePath::operator=(NodePath());
+	}
+	return *this;
 }
 
 void SceneText::duplicate_parenting(const SceneText& other)
 {
-	if(other.get_parent().is_empty())
-	{
-	  NodePath::operator=(NodePath(m_textNode));
-	}
-	else
+	NodePath holder(other.get_name());
+	holder.node()->copy_all_properties(other.node());
+	holder.node()->add_child(m_textNode);
+	
+	if(!other.get_parent().is_empty())
 	{
-	  NodePath::operator=(other.get_parent().attach_new_node(m_textNode, other.get_sort()));
+	  holder.reparent_to(other.get_parent(), other.get_sort());
 	}
+	
+	NodePath::operator=(holder);
+	update_transform_mat();
+}
+
+bool SceneText::detach()
+{
+	if(m_textNode == nullptr)
+	  return false;
+	
+	// Our pointer and our holder's child link are the only references of an unshared node.
+	if(m_textNode->get_ref_count() <= 2)
+	  return true;
+	
+	// Copy on write, the other owners keep the current node and its geometry.
+	PT(TextNodeProxy) copy = new TextNodeProxy(*m_textNode);
+	
+	node()->remove_child(m_textNode);
+	m_textNode = copy;
+	node()->add_child(m_textNode);
+	return true;
+}
+
+void SceneText::update_transform_mat()
+{
+	if(is_empty())
+	  return;
+	
+	LMatrix4f mat =
+		LMatrix4f::scale_mat(m_scale.get_x(), 1, m_scale.get_y()) *
+		LMatrix4f::rotate_mat(m_roll, LVecBase3f(0, -1, 0)) *
+		LMatrix4f::translate_mat(m_pos.get_x(), 0, m_pos.get_y());
+	set_mat(mat);
 }
 
 void SceneText::cleanup()
 {
-	m_textNode = NULL;
-	remove_node();
+	m_textNode = nullptr;
+	
+	if(!is_empty())
+	{
+	  remove_node();
+	}
 }
 
 void SceneText::clear_text()
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->clear_text();
 }
 
 void SceneText::append_text(const std::string& text)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->append_text(text);
 }
 
 NodePath SceneText::generate() const
 {
+	NodePath result;
+	if(m_textNode == nullptr)
+	  return result;
+	
 	if(get_parent().is_empty())
-	  return NodePath(m_textNode->generate());
+	  result = NodePath(m_textNode->generate());
 	else
-	  return get_parent().attach_new_node(m_textNode->generate(), get_sort());
+	  result = get_parent().attach_new_node(m_textNode->generate(), get_sort());
+	
+	// the transform lives on the holder, not on the text node
+	result.set_transform(get_transform());
+	return result;
 }
 
 void SceneText::set_font(TextFont* fontPtr)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_font(fontPtr);
 }
 
 void SceneText::set_text(const std::string& text)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_text(text);
 }
 
 void SceneText::set_decal(bool decal)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_card_decal(decal);
 }
 
 void SceneText::set_x(float x)
 {
-	set_pos(LVecBase2f(x, m_textNode->m_pos.get_y()));
+	set_pos(LVecBase2f(x, m_pos.get_y()));
 }
 
 void SceneText::set_y(float y)
 {
-	set_pos(LVecBase2f(m_textNode->m_pos.get_x(), y));
+	set_pos(LVecBase2f(m_pos.get_x(), y));
 }
 
 void SceneText::set_pos(float x, float y)
@@ -236,8 +313,8 @@ void SceneText::set_pos(float x, float y)
 
 void SceneText::set_pos(const LVecBase2f& pos)
 {
-	m_textNode->m_pos = pos;
-	m_textNode->update_transform_mat();
+	m_pos = pos;
+	update_transform_mat();
 }
 
 void SceneText::set_scale(float scale)
@@ -252,18 +329,21 @@ void SceneText::set_scale(float scaleX, float scaleY)
 
 void SceneText::set_scale(const LVecBase2f& scale)
 {
-	m_textNode->m_scale = scale;
-	m_textNode->update_transform_mat();
+	m_scale = scale;
+	update_transform_mat();
 }
 
 void SceneText::set_roll(float roll)
 {
-	m_textNode->m_roll = roll;
-	m_textNode->update_transform_mat();
+	m_roll = roll;
+	update_transform_mat();
 }
 
 void SceneText::set_wordwrap(float wordwrap)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->m_wordwrap = wordwrap;
 	if(wordwrap != 0)
 	{
@@ -277,11 +357,17 @@ void SceneText::set_wordwrap(float wordwrap)
 
 void SceneText::set_fg(const LColorf& fg)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_text_color(fg);
 }
 
 void SceneText::set_bg(const LColorf& bg)
 {
+	if(!detach())
+	  return;
+	
 	if(bg[3] > 0)
 	{
 	  // If we have a background color, create a card.
@@ -297,6 +383,9 @@ void SceneText::set_bg(const LColorf& bg)
 
 void SceneText::set_shadow(const LColorf& shadow)
 {
+	if(!detach())
+	  return;
+	
 	if(shadow[3] > 0)
 	{
 	  // If we have a shadow color, create a shadow.
@@ -312,11 +401,17 @@ void SceneText::set_shadow(const LColorf& shadow)
 
 void SceneText::set_shadow_offset(const LVecBase2f& offset)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_shadow(offset);
 }
 
 void SceneText::set_frame(const LColorf& frame)
 {
+	if(!detach())
+	  return;
+	
 	if(frame[3] > 0)
 	{
 	  // If we have a frame color, create a frame.
@@ -332,46 +427,52 @@ void SceneText::set_frame(const LColorf& frame)
 
 void SceneText::set_align(TextNode::Alignment align)
 {
-	return m_textNode->set_align(align);
+	if(!detach())
+	  return;
+	
+	m_textNode->set_align(align);
 }
 
 void SceneText::set_draw_order(int drawOrder)
 {
+	if(!detach())
+	  return;
+	
 	m_textNode->set_bin("fixed");
 	m_textNode->set_draw_order(drawOrder);
 }
 
 TextFont* SceneText::get_font() const
 {
-	return m_textNode->get_font();
+	return m_textNode != nullptr ? m_textNode->get_font() : nullptr;
 }
 
 std::string SceneText::get_text() const
 {
-	return m_textNode->get_text();
+	return m_textNode != nullptr ? m_textNode->get_text() : std::string();
 }
 
 bool SceneText::get_decal() const
 {
-	return m_textNode->get_card_decal();
+	return m_textNode != nullptr && m_textNode->get_card_decal();
 }
 
 const LVecBase2f& SceneText::get_pos() const
 {
-	return m_textNode->m_pos;
+	return m_pos;
 }
 
 const LVecBase2f& SceneText::get_scale() const
 {
-	return m_textNode->m_scale;
+	return m_scale;
 }
 
 float SceneText::get_roll() const
 {
-	return m_textNode->m_roll;
+	return m_roll;
 }
 
 float SceneText::get_wordwrap() const
 {
-	return m_textNode->m_wordwrap;
+	return m_textNode != nullptr ? m_textNode->m_wordwrap : 0.0f;
 }
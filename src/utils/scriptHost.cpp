@@ -0,0 +1,254 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <clockObject.h>
+#include <filename.h>
+#include <datagram.h>
+#include <datagramIterator.h>
+
+#if defined(__WIN32__) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "taskUtils.hpp"
+#include "runtimeScript.hpp"
+#include "scriptHost.hpp"
+
+
+namespace {
+	void* open_library(const std::string& path) {
+#if defined(__WIN32__) || defined(_WIN32)
+		return (void*)LoadLibraryA(path.c_str());
+#else
+		return dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+#endif
+	}
+
+	void* find_symbol(void* handle, const char* name) {
+#if defined(__WIN32__) || defined(_WIN32)
+		return (void*)GetProcAddress((HMODULE)handle, name);
+#else
+		return dlsym(handle, name);
+#endif
+	}
+
+	void close_library(void* handle) {
+#if defined(__WIN32__) || defined(_WIN32)
+		FreeLibrary((HMODULE)handle);
+#else
+		dlclose(handle);
+#endif
+	}
+
+	std::string library_error() {
+#if defined(__WIN32__) || defined(_WIN32)
+		return "error code " + std::to_string(GetLastError());
+#else
+		const char* error = dlerror();
+		return error ? error : "unknown error";
+#endif
+	}
+
+	// The loader caches libraries by path and Windows locks loaded files, so a private
+	// copy is opened, leaving the original free to be overwritten by the next build.
+	bool copy_file(const std::string& from, const std::string& to) {
+		std::ifstream src(from, std::ios::binary);
+		std::ofstream dst(to, std::ios::binary | std::ios::trunc);
+		if (!src || !dst)
+			return false;
+
+		dst << src.rdbuf();
+		return static_cast<bool>(dst);
+	}
+
+	time_t get_timestamp(const std::string& path) {
+		Filename file = Filename::from_os_specific(path);
+		return file.exists() ? file.get_timestamp() : 0;
+	}
+}
+
+ScriptHost::ScriptHost() : poll_interval_(0.5), last_poll_(0.0) {
+	watch_task_ = make_task([this](AsyncTask*) -> AsyncTask::DoneStatus {
+		double now = ClockObject::get_global_clock()->get_real_time();
+		if (poll_interval_ > 0.0 && now - last_poll_ >= poll_interval_) {
+			last_poll_ = now;
+			poll();
+		}
+		return AsyncTask::DS_cont;
+	}, "ScriptHostWatch");
+
+	AsyncTaskManager::get_global_ptr()->add(watch_task_);
+}
+
+ScriptHost::~ScriptHost() {
+	remove_task(watch_task_.p());
+	unload_all();
+}
+
+bool ScriptHost::load(const std::string& path) {
+	if (find_module(path)) {
+		std::cout << "ScriptHost: " << path << " is already loaded" << std::endl;
+		return false;
+	}
+
+	Module module;
+	module.path = path;
+	module.timestamp = get_timestamp(path);
+
+	if (!open_module(module))
+		return false;
+
+	modules_.push_back(module);
+	return true;
+}
+
+bool ScriptHost::reload(const std::string& path) {
+	Module* module = find_module(path);
+	if (!module)
+		return load(path);
+
+	// carry the state of the running instance over to the new one
+	if (module->script) {
+		module->state.clear();
+		module->script->save_state(module->state);
+	}
+
+	const bool was_running = module->script && has_task(module->script->task_name);
+
+	close_module(*module);
+	module->timestamp = get_timestamp(path);
+	if (!open_module(*module)) {
+		std::cerr << "ScriptHost: reload failed, " << path << " stays unloaded until it changes again" << std::endl;
+		return false;
+	}
+
+	if (module->state.get_length() > 0) {
+		DatagramIterator scan(module->state);
+		module->script->load_state(scan);
+		module->state.clear();
+	}
+
+	if (was_running)
+		module->script->start_update_task();
+
+	std::cout << "ScriptHost: reloaded " << path << std::endl;
+	return true;
+}
+
+void ScriptHost::unload(const std::string& path) {
+	auto it = std::find_if(modules_.begin(), modules_.end(), [&path](const Module& m) { return m.path == path; });
+	if (it == modules_.end())
+		return;
+
+	close_module(*it);
+	modules_.erase(it);
+}
+
+void ScriptHost::unload_all() {
+	// destroy in reverse load order, later scripts may depend on earlier ones
+	for (auto it = modules_.rbegin(); it != modules_.rend(); ++it)
+		close_module(*it);
+
+	modules_.clear();
+}
+
+void ScriptHost::set_poll_interval(double interval) {
+	poll_interval_ = interval;
+}
+
+RuntimeScript* ScriptHost::get_script(const std::string& path) const {
+	const Module* module = find_module(path);
+	return module ? module->script : nullptr;
+}
+
+ScriptHost::Module* ScriptHost::find_module(const std::string& path) {
+	for (Module& module : modules_) {
+		if (module.path == path)
+			return &module;
+	}
+	return nullptr;
+}
+
+const ScriptHost::Module* ScriptHost::find_module(const std::string& path) const {
+	for (const Module& module : modules_) {
+		if (module.path == path)
+			return &module;
+	}
+	return nullptr;
+}
+
+bool ScriptHost::open_module(Module& module) {
+	module.loaded_path = module.path + "." + std::to_string(module.generation++) + ".loaded";
+	if (!copy_file(module.path, module.loaded_path)) {
+		std::cerr << "ScriptHost: could not copy " << module.path << std::endl;
+		return false;
+	}
+
+	module.handle = open_library(module.loaded_path);
+	if (!module.handle) {
+		std::cerr << "ScriptHost: could not load " << module.path << ", " << library_error() << std::endl;
+		std::remove(module.loaded_path.c_str());
+		return false;
+	}
+
+	ApiVersionFn api_version = (ApiVersionFn)find_symbol(module.handle, "runtime_script_api_version");
+	CreateFn     create      = (CreateFn)find_symbol(module.handle, "create_runtime_script");
+	module.destroy           = (DestroyFn)find_symbol(module.handle, "destroy_runtime_script");
+
+	if (!api_version || !create || !module.destroy) {
+		std::cerr << "ScriptHost: " << module.path << " is not a script module, see RUNTIME_SCRIPT_MODULE" << std::endl;
+		close_module(module);
+		return false;
+	}
+
+	if (api_version() != RUNTIME_SCRIPT_API_VERSION) {
+		std::cerr << "ScriptHost: " << module.path << " was built against a different RuntimeScript version" << std::endl;
+		close_module(module);
+		return false;
+	}
+
+	module.script = create();
+	return module.script != nullptr;
+}
+
+void ScriptHost::close_module(Module& module) {
+	// the instance must be destroyed by the module that created it
+	if (module.script && module.destroy)
+		module.destroy(module.script);
+
+	module.script = nullptr;
+	module.destroy = nullptr;
+
+	if (module.handle) {
+		close_library(module.handle);
+		module.handle = nullptr;
+	}
+
+	if (!module.loaded_path.empty()) {
+		std::remove(module.loaded_path.c_str());
+		module.loaded_path.clear();
+	}
+}
+
+void ScriptHost::poll() {
+	for (Module& module : modules_) {
+		time_t stamp = get_timestamp(module.path);
+		if (stamp == 0 || stamp == module.timestamp) {
+			module.pending_stamp = 0;
+			continue;
+		}
+
+		// wait for one quiet poll so a library still being written by the linker is not opened
+		if (stamp != module.pending_stamp) {
+			module.pending_stamp = stamp;
+			continue;
+		}
+
+		module.pending_stamp = 0;
+		reload(module.path);
+	}
+}
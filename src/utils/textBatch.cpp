@@ -0,0 +1,435 @@
+#include <algorithm>
+
+#include <geomNode.h>
+#include <geomTriangles.h>
+#include <geomVertexData.h>
+#include <geomVertexFormat.h>
+#include <geomVertexWriter.h>
+#include <omniBoundingVolume.h>
+#include <textEncoder.h>
+#include <textGlyph.h>
+#include <textProperties.h>
+#include <transparencyAttrib.h>
+
+#include "textBatch.hpp"
+
+// labels get a little room to grow before they have to move
+static int round_capacity(int count) {
+    return (count + 7) & ~7;
+}
+
+TextBatch::TextBatch(const std::string& name, TextFont* font) :
+    NodePath(name),
+    font_(font ? font : TextProperties::get_default_font()),
+    num_updated_(0) {
+
+    geom_node_ = new GeomNode(name);
+    // labels are rewritten in place and never recompute the bounds, so never cull the batch
+    geom_node_->set_bounds(new OmniBoundingVolume());
+    geom_node_->set_final(true);
+    NodePath::operator=(NodePath(geom_node_));
+    set_transparency(TransparencyAttrib::M_alpha);
+}
+
+int TextBatch::add(const std::string& text, const LVecBase2f& pos, float scale, const LColorf& color,
+                   TextNode::Alignment align) {
+    int id;
+    if (!free_ids_.empty()) {
+        id = free_ids_.back();
+        free_ids_.pop_back();
+    }
+    else {
+        id = static_cast<int>(labels_.size());
+        labels_.emplace_back();
+    }
+
+    Label& label = labels_[id];
+    label.text = text;
+    label.pos = pos;
+    label.scale = LVecBase2f(scale, scale);
+    label.color = color;
+    label.align = align;
+    label.alive = true;
+    label.dirty = false;
+    label.visible = true;
+    label.allocations.clear();
+
+    mark_dirty(id);
+    return id;
+}
+
+void TextBatch::remove(int id) {
+    if (!is_valid(id))
+        return;
+
+    Label& label = labels_[id];
+    for (const Allocation& allocation : label.allocations)
+        release(allocation);
+
+    label.allocations.clear();
+    label.text.clear();
+    label.alive = false;
+    free_ids_.push_back(id);
+}
+
+void TextBatch::clear() {
+    for (int id = 0; id < static_cast<int>(labels_.size()); ++id)
+        remove(id);
+}
+
+void TextBatch::set_text(int id, const std::string& text) {
+    if (!is_valid(id) || labels_[id].text == text)
+        return;
+
+    labels_[id].text = text;
+    mark_dirty(id);
+}
+
+void TextBatch::set_pos(int id, const LVecBase2f& pos) {
+    if (!is_valid(id) || labels_[id].pos == pos)
+        return;
+
+    labels_[id].pos = pos;
+    mark_dirty(id);
+}
+
+void TextBatch::set_scale(int id, float scale) {
+    set_scale(id, LVecBase2f(scale, scale));
+}
+
+void TextBatch::set_scale(int id, const LVecBase2f& scale) {
+    if (!is_valid(id) || labels_[id].scale == scale)
+        return;
+
+    labels_[id].scale = scale;
+    mark_dirty(id);
+}
+
+void TextBatch::set_color(int id, const LColorf& color) {
+    if (!is_valid(id) || labels_[id].color == color)
+        return;
+
+    labels_[id].color = color;
+    mark_dirty(id);
+}
+
+void TextBatch::set_align(int id, TextNode::Alignment align) {
+    if (!is_valid(id) || labels_[id].align == align)
+        return;
+
+    labels_[id].align = align;
+    mark_dirty(id);
+}
+
+void TextBatch::set_visible(int id, bool visible) {
+    if (!is_valid(id) || labels_[id].visible == visible)
+        return;
+
+    labels_[id].visible = visible;
+    mark_dirty(id);
+}
+
+LVecBase2f TextBatch::measure(const std::string& text) const {
+    std::wstring decoded = TextEncoder::decode_text(text, TextEncoder::E_utf8);
+
+    PN_stdfloat width = 0.0f, line_width = 0.0f;
+    int num_lines = 1;
+    for (wchar_t character : decoded) {
+        if (character == L'\n') {
+            width = std::max(width, line_width);
+            line_width = 0.0f;
+            ++num_lines;
+            continue;
+        }
+
+        CPT(TextGlyph) glyph;
+        line_width += font_->get_glyph(character, glyph) && glyph ? glyph->get_advance() : font_->get_space_advance();
+    }
+
+    return LVecBase2f(std::max(width, line_width), num_lines * font_->get_line_height());
+}
+
+const std::string& TextBatch::get_text(int id) const {
+    static const std::string empty;
+    return is_valid(id) ? labels_[id].text : empty;
+}
+
+bool TextBatch::is_valid(int id) const {
+    return id >= 0 && id < static_cast<int>(labels_.size()) && labels_[id].alive;
+}
+
+void TextBatch::update() {
+    num_updated_ = 0;
+
+    std::vector<GlyphQuad> quads;
+    std::vector<int> counts;
+
+    for (int id : dirty_ids_) {
+        if (!is_valid(id) || !labels_[id].dirty)
+            continue;
+
+        Label& label = labels_[id];
+        label.dirty = false;
+        ++num_updated_;
+
+        if (!label.visible) {
+            for (Allocation& allocation : label.allocations) {
+                zero_quads(layers_[allocation.layer], allocation.first, allocation.used);
+                allocation.used = 0;
+            }
+            continue;
+        }
+
+        layout(label, quads);
+
+        // quads sorted by page so each allocation is written in one run
+        std::stable_sort(quads.begin(), quads.end(),
+            [](const GlyphQuad& a, const GlyphQuad& b) { return a.layer < b.layer; });
+
+        counts.assign(layers_.size(), 0);
+        for (const GlyphQuad& quad : quads)
+            ++counts[quad.layer];
+
+        // keep the ranges that are still big enough, they are rewritten in place
+        std::vector<Allocation> allocations;
+        for (const Allocation& allocation : label.allocations) {
+            if (counts[allocation.layer] > 0 && counts[allocation.layer] <= allocation.capacity)
+                allocations.push_back(allocation);
+            else
+                release(allocation);
+        }
+
+        for (int layer = 0; layer < static_cast<int>(counts.size()); ++layer) {
+            if (counts[layer] == 0)
+                continue;
+
+            auto it = std::find_if(allocations.begin(), allocations.end(),
+                [layer](const Allocation& a) { return a.layer == layer; });
+            if (it == allocations.end())
+                allocations.push_back(allocate(layer, round_capacity(counts[layer])));
+        }
+
+        std::vector<GlyphQuad> layer_quads;
+        for (Allocation& allocation : allocations) {
+            layer_quads.clear();
+            for (const GlyphQuad& quad : quads) {
+                if (quad.layer == allocation.layer)
+                    layer_quads.push_back(quad);
+            }
+
+            write_quads(label, allocation, layer_quads);
+
+            // the previous text may have been longer
+            const int count = static_cast<int>(layer_quads.size());
+            if (allocation.used > count)
+                zero_quads(layers_[allocation.layer], allocation.first + count, allocation.used - count);
+            allocation.used = count;
+        }
+
+        label.allocations.swap(allocations);
+    }
+
+    dirty_ids_.clear();
+}
+
+void TextBatch::mark_dirty(int id) {
+    Label& label = labels_[id];
+    if (label.dirty)
+        return;
+
+    label.dirty = true;
+    dirty_ids_.push_back(id);
+}
+
+void TextBatch::layout(const Label& label, std::vector<GlyphQuad>& quads) {
+    quads.clear();
+
+    std::wstring text = TextEncoder::decode_text(label.text, TextEncoder::E_utf8);
+    const PN_stdfloat line_height = font_->get_line_height();
+
+    size_t line_start = 0;
+    int line = 0;
+    while (line_start <= text.size()) {
+        size_t line_end = text.find(L'\n', line_start);
+        if (line_end == std::wstring::npos)
+            line_end = text.size();
+
+        // the line width is needed up front for centered and right aligned text
+        PN_stdfloat width = 0.0f;
+        for (size_t i = line_start; i < line_end; ++i) {
+            CPT(TextGlyph) glyph;
+            width += font_->get_glyph(text[i], glyph) && glyph ? glyph->get_advance() : font_->get_space_advance();
+        }
+
+        PN_stdfloat x = 0.0f;
+        if (label.align == TextNode::A_center)
+            x = -width * 0.5f;
+        else if (label.align == TextNode::A_right)
+            x = -width;
+
+        const PN_stdfloat y = -line * line_height;
+
+        for (size_t i = line_start; i < line_end; ++i) {
+            CPT(TextGlyph) glyph;
+            if (!font_->get_glyph(text[i], glyph) || !glyph) {
+                x += font_->get_space_advance();
+                continue;
+            }
+
+            GlyphQuad quad;
+            if (glyph->get_quad(quad.dimensions, quad.texcoords)) {
+                quad.layer = get_layer(glyph->get_state());
+                quad.dimensions[0] += x;
+                quad.dimensions[2] += x;
+                quad.dimensions[1] += y;
+                quad.dimensions[3] += y;
+                quads.push_back(quad);
+            }
+
+            x += glyph->get_advance();
+        }
+
+        line_start = line_end + 1;
+        ++line;
+    }
+}
+
+int TextBatch::get_layer(const RenderState* state) {
+    auto it = layer_lookup_.find(state);
+    if (it != layer_lookup_.end())
+        return it->second;
+
+    Layer layer;
+    layer.state = state;
+
+    PT(GeomVertexData) vdata = new GeomVertexData("text", GeomVertexFormat::get_v3c4t2(), Geom::UH_dynamic);
+    layer.geom = new Geom(vdata);
+    layer.geom->add_primitive(new GeomTriangles(Geom::UH_static));
+    geom_node_->add_geom(layer.geom, state);
+
+    const int index = static_cast<int>(layers_.size());
+    layers_.push_back(layer);
+    layer_lookup_[state] = index;
+    return index;
+}
+
+TextBatch::Allocation TextBatch::allocate(int layer_index, int count) {
+    Layer& layer = layers_[layer_index];
+
+    Allocation allocation;
+    allocation.layer = layer_index;
+    allocation.capacity = count;
+    allocation.used = 0;
+
+    // first fit in the holes left by removed or moved labels
+    for (size_t i = 0; i < layer.free_ranges.size(); ++i) {
+        Range& range = layer.free_ranges[i];
+        if (range.count < count)
+            continue;
+
+        allocation.first = range.first;
+        range.first += count;
+        range.count -= count;
+        if (range.count == 0)
+            layer.free_ranges.erase(layer.free_ranges.begin() + i);
+        return allocation;
+    }
+
+    if (layer.end + count > layer.capacity)
+        grow(layer, std::max(layer.capacity * 2, layer.end + count));
+
+    allocation.first = layer.end;
+    layer.end += count;
+    return allocation;
+}
+
+void TextBatch::release(const Allocation& allocation) {
+    Layer& layer = layers_[allocation.layer];
+    zero_quads(layer, allocation.first, allocation.used);
+
+    // keep the holes sorted and merged so big labels can reuse them
+    Range range = { allocation.first, allocation.capacity };
+    auto it = std::lower_bound(layer.free_ranges.begin(), layer.free_ranges.end(), range,
+        [](const Range& a, const Range& b) { return a.first < b.first; });
+    it = layer.free_ranges.insert(it, range);
+
+    if (it + 1 != layer.free_ranges.end() && it->first + it->count == (it + 1)->first) {
+        it->count += (it + 1)->count;
+        layer.free_ranges.erase(it + 1);
+    }
+    if (it != layer.free_ranges.begin() && (it - 1)->first + (it - 1)->count == it->first) {
+        (it - 1)->count += it->count;
+        layer.free_ranges.erase(it);
+    }
+}
+
+void TextBatch::grow(Layer& layer, int capacity) {
+    capacity = std::max(capacity, 64);
+    const int old_capacity = layer.capacity;
+
+    PT(GeomVertexData) vdata = layer.geom->modify_vertex_data();
+    vdata->set_num_rows(capacity * 4);
+
+    PT(GeomPrimitive) tris = layer.geom->modify_primitive(0);
+    if (capacity * 4 > 0xffff)
+        tris->set_index_type(GeomEnums::NT_uint32);
+
+    // indices never change once written, unused quads are collapsed to a point instead
+    for (int q = old_capacity; q < capacity; ++q) {
+        const int v = q * 4;
+        tris->add_vertices(v, v + 1, v + 3);
+        tris->add_vertices(v, v + 3, v + 2);
+    }
+
+    layer.capacity = capacity;
+    zero_quads(layer, old_capacity, capacity - old_capacity);
+}
+
+void TextBatch::write_quads(const Label& label, const Allocation& allocation, const std::vector<GlyphQuad>& quads) {
+    if (quads.empty())
+        return;
+
+    PT(GeomVertexData) vdata = layers_[allocation.layer].geom->modify_vertex_data();
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    GeomVertexWriter color(vdata, InternalName::get_color());
+    GeomVertexWriter texcoord(vdata, InternalName::get_texcoord());
+
+    vertex.set_row(allocation.first * 4);
+    color.set_row(allocation.first * 4);
+    texcoord.set_row(allocation.first * 4);
+
+    const float sx = label.scale[0], sy = label.scale[1];
+    const float px = label.pos[0], py = label.pos[1];
+
+    for (const GlyphQuad& quad : quads) {
+        const float left   = px + quad.dimensions[0] * sx;
+        const float bottom = py + quad.dimensions[1] * sy;
+        const float right  = px + quad.dimensions[2] * sx;
+        const float top    = py + quad.dimensions[3] * sy;
+
+        vertex.set_data3(left,  0, bottom);
+        vertex.set_data3(right, 0, bottom);
+        vertex.set_data3(left,  0, top);
+        vertex.set_data3(right, 0, top);
+
+        texcoord.set_data2(quad.texcoords[0], quad.texcoords[1]);
+        texcoord.set_data2(quad.texcoords[2], quad.texcoords[1]);
+        texcoord.set_data2(quad.texcoords[0], quad.texcoords[3]);
+        texcoord.set_data2(quad.texcoords[2], quad.texcoords[3]);
+
+        for (int i = 0; i < 4; ++i)
+            color.set_data4(label.color);
+    }
+}
+
+void TextBatch::zero_quads(Layer& layer, int first, int count) {
+    if (count <= 0)
+        return;
+
+    // a quad with all four corners in one point has no area and draws nothing
+    PT(GeomVertexData) vdata = layer.geom->modify_vertex_data();
+    GeomVertexWriter vertex(vdata, InternalName::get_vertex());
+    vertex.set_row(first * 4);
+    for (int i = 0; i < count * 4; ++i)
+        vertex.set_data3(0, 0, 0);
+}